@@ -1,290 +1,789 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
+#include "graph.h"
+#include "queue.h"
+#include "search.h"
+#include "query.h"
+#include "pool.h"
+#include "alt.h"
+#include "bidir.h"
+#include "snapshot.h"
+#include "parse.h"
+#include "oracle.h"
+#include "ch.h"
+#include "reach.h"
+#include "reorder.h"
+#include "stats.h"
+#include "update.h"
+#include "tree.h"
+#include "cache.h"
+#include "matrix.h"
+
+#define DEFAULT_BATCH_WINDOW 65536
+
+// Parse a byte count such as 512M or 8G
+static int parse_bytes(const char *text, size_t *out) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) return -1;
+    switch (*end) {
+    case 'G': case 'g': value <<= 10; // fall through
+    case 'M': case 'm': value <<= 10; // fall through
+    case 'K': case 'k': value <<= 10; end++; break;
+    case '\0': break;
+    default: return -1;
+    }
+    if (*end != '\0') return -1;
+    *out = value;
+    return 0;
+}
 
-#define MAX_VERTICES 1000
-#define INF INT_MAX
-
-// Structure for an edge in the adjacency list
-typedef struct Edge {
-    int target;          // Target vertex
-    int *weights;        // Array of weights for each period
-    struct Edge *next;   // Pointer to the next edge
-} Edge;
-
-// Structure for the graph
-typedef struct Graph {
-    int V;               // Number of vertices
-    int N;               // Period of weights
-    Edge *adj[MAX_VERTICES]; // Adjacency list
-} Graph;
-
-// Structure for a node in the priority queue
-typedef struct Node {
-    int vertex;
-    int step;
-    int cost;
-} Node;
-
-// Min-heap for priority queue
-typedef struct MinHeap {
-    Node *nodes[MAX_VERTICES * 10];
-    int size;
-} MinHeap;
-
-// Function to create a new graph
-Graph *create_graph(int V, int N) {
-    Graph *graph = malloc(sizeof(Graph));
-    graph->V = V;
-    graph->N = N;
-    for (int i = 0; i < V; ++i) {
-        graph->adj[i] = NULL;
-    }
-    return graph;
+// Parse a comma-separated list of vertex ids such as 3,17,42
+static int parse_vertices(const char *text, int **out, int *count) {
+    int capacity = 1;
+    for (const char *c = text; *c; c++) capacity += *c == ',';
+    int *vertices = malloc(capacity * sizeof(int));
+    if (!vertices) return -1;
+    int n = 0;
+    const char *at = text;
+    for (;;) {
+        char *end;
+        long v = strtol(at, &end, 10);
+        if (end == at || v < 0 || v > INT_MAX || (*end != ',' && *end != '\0')) {
+            free(vertices);
+            return -1;
+        }
+        vertices[n++] = (int)v;
+        if (*end == '\0') break;
+        at = end + 1;
+    }
+    *out = vertices;
+    *count = n;
+    return 0;
 }
 
-// Function to add an edge to the graph
-void add_edge(Graph *graph, int src, int dest, int *weights) {
-    Edge *edge = malloc(sizeof(Edge));
-    edge->target = dest;
-    edge->weights = weights;
-    edge->next = graph->adj[src];
-    graph->adj[src] = edge;
+// Default memory budget: the machine's physical memory
+static size_t physical_memory(void) {
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || page_size <= 0) return SIZE_MAX;
+    return (size_t)pages * page_size;
 }
 
-// Helper function to create a new node for the priority queue
-Node *new_node(int vertex, int step, int cost) {
-    Node *node = malloc(sizeof(Node));
-    node->vertex = vertex;
-    node->step = step;
-    node->cost = cost;
-    return node;
+// Check the V x N search state of every worker against the budget before
+// allocating it
+static int check_budget(int V, int N, const SearchConfig *config, int threads,
+                        size_t mem_budget, bool verbose) {
+    size_t state_bytes = search_state_bytes(V, N, config) * threads;
+    if (verbose) {
+        fprintf(stderr, "%d x %d = %zu states need %zu bytes (budget %zu)\n",
+                V, N, (size_t)V * N, state_bytes, mem_budget);
+    }
+    if ((size_t)V * N >= HEAP_ABSENT) {
+        fprintf(stderr, "%d x %d states exceed the 32-bit state index\n", V, N);
+        return -1;
+    }
+    if (state_bytes > mem_budget) {
+        fprintf(stderr, "%d x %d = %zu states need %zu bytes, over the memory budget of %zu\n",
+                V, N, (size_t)V * N, state_bytes, mem_budget);
+        return -1;
+    }
+    return 0;
 }
 
-// Function to initialize a min-heap
-MinHeap *create_min_heap() {
-    MinHeap *heap = malloc(sizeof(MinHeap));
-    heap->size = 0;
-    return heap;
+static int online_cpus(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
 }
 
-// Min-heap utility functions
-void swap(Node **a, Node **b) {
-    Node *temp = *a;
-    *a = *b;
-    *b = temp;
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
 }
 
-void heapify_up(MinHeap *heap, int idx) {
-    if (idx && heap->nodes[idx] && heap->nodes[(idx - 1) / 2]) {
-        if (heap->nodes[idx]->cost < heap->nodes[(idx - 1) / 2]->cost) {
-            swap(&heap->nodes[idx], &heap->nodes[(idx - 1) / 2]);
-            heapify_up(heap, (idx - 1) / 2);
+// Answer queries interleaved with U/I/D edge updates. Each run of updates
+// becomes one new graph version, published before the next query is read;
+// queries already handed to the workers keep searching the version they
+// were read against. Takes over the reference to current.
+static int serve_with_updates(Workspace *ws, Pool *pool, GraphVersion *current, HotTrees *hot, const Ordering *ordering,
+                              size_t mem_budget, StatsLog *stats_log, bool verbose) {
+    CommandReader reader = {0};
+    reader.in = stdin;
+    reader.V = current->graph.V;
+    reader.N = current->graph.N;
+    reader.to_inner = ordering ? ordering->to_inner : NULL;
+    Update *pending = NULL;
+    size_t npending = 0;
+    size_t capacity = 0;
+    int status = 0;
+
+    Command command;
+    do {
+        Query query;
+        Update update;
+        command = read_command(&reader, &query, &update);
+        if (command == COMMAND_UPDATE) {
+            if (npending == capacity) {
+                size_t grown_capacity = capacity ? capacity * 2 : 64;
+                Update *grown = realloc(pending, grown_capacity * sizeof(Update));
+                if (!grown) {
+                    fprintf(stderr, "Out of memory reading updates\n");
+                    free(update.weights);
+                    status = -1;
+                    break;
+                }
+                pending = grown;
+                capacity = grown_capacity;
+            }
+            pending[npending++] = update;
+            continue;
         }
-    }
+        if (npending > 0) {
+            GraphVersion *next = apply_updates(current, pending, npending, mem_budget);
+            // Hot trees move to the new version before any query sees it
+            if (next && hot && repair_hot_trees(hot, next, pending, npending) != 0) {
+                release_version(next);
+                next = NULL;
+            }
+            free_updates(pending, npending);
+            npending = 0;
+            if (!next) {
+                status = -1;
+                break;
+            }
+            release_version(current);
+            current = next;
+            if (verbose) {
+                fprintf(stderr, "version %llu: %lld edges", (unsigned long long)current->number,
+                        (long long)current->graph.E);
+                if (hot) fprintf(stderr, ", %zu tree states relabelled", hot->relabelled);
+                fprintf(stderr, "\n");
+            }
+        }
+        if (command == COMMAND_QUERY) {
+            acquire_version(current);
+            query.version = current;
+            if (pool) {
+                pool_submit(pool, &query, stdout, stats_log);
+            } else {
+                answer_query(ws, &query);
+                print_answer(stdout, &query);
+                if (stats_log) log_query_stats(stats_log, &query);
+                release_answers(&query, 1);
+            }
+        }
+    } while (command != COMMAND_END);
+
+    if (pool) pool_finish(pool, stdout, stats_log);
+    free_updates(pending, npending);
+    free(pending);
+    free(reader.line);
+    release_version(current);
+    return status;
 }
 
-void heapify_down(MinHeap *heap, int idx) {
-    int smallest = idx;
-    int left = 2 * idx + 1;
-    int right = 2 * idx + 2;
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <input_file>\n", prog);
+    fprintf(stderr, "Queries are read from stdin, one \"start end [phase]\" per line.\n");
+    fprintf(stderr, "  --mem-budget BYTES   limit for V x N search state (K/M/G suffix)\n");
+    fprintf(stderr, "  --engine NAME        queue engine: auto, heap, dial or radix\n");
+    fprintf(stderr, "  --kernel NAME        edge relaxation kernel: auto, scalar, sse4 or avx2\n");
+    fprintf(stderr, "  --threads N          answer queries on N worker threads\n");
+    fprintf(stderr, "  --batch              answer queries in windows, one search per start\n");
+    fprintf(stderr, "  --window N           queries per batch window (0 reads all input)\n");
+    fprintf(stderr, "  --alt K              goal-directed A* with K ALT landmarks\n");
+    fprintf(stderr, "  --landmarks NAME     landmark selection: farthest or avoid\n");
+    fprintf(stderr, "  --bidir              bidirectional search on the reversed graph\n");
+    fprintf(stderr, "  --oracle             precompute all-pairs answers before reading queries\n");
+    fprintf(stderr, "  --oracle-file FILE   load the oracle from FILE, or build and save it there\n");
+    fprintf(stderr, "  --ch                 contract the graph into a hierarchy and query it\n");
+    fprintf(stderr, "  --updates            accept U/I/D edge updates between queries, one per line\n");
+    fprintf(stderr, "  --hot LIST           keep shortest-path trees of these sources, repaired on updates\n");
+    fprintf(stderr, "  --profile            answer every departure phase of each query in one search\n");
+    fprintf(stderr, "  --cache BYTES        keep suspended searches per source up to BYTES, LRU evicted\n");
+    fprintf(stderr, "  --matrix[=FORMAT]    read a line of sources and a line of targets, write the\n");
+    fprintf(stderr, "                       cost matrix as csv (default) or binary\n");
+    fprintf(stderr, "  --matrix-paths FILE  with --matrix, also write every pair's path to FILE\n");
+    fprintf(stderr, "  --reachable          only answer whether each end is reachable\n");
+    fprintf(stderr, "  --reorder NAME       renumber vertices for locality: none, bfs or rcm\n");
+    fprintf(stderr, "  --stats[=FILE]       per-query search counters as JSON lines (make STATS=1)\n");
+    fprintf(stderr, "  --perf[=FILE]        hardware counters per query as JSON lines, in the --stats log\n");
+    fprintf(stderr, "  --convert FILE       write the graph as a binary snapshot and exit\n");
+    fprintf(stderr, "  --verify             check every array of a snapshot while loading it\n");
+    fprintf(stderr, "  --verbose            report sizes on stderr\n");
+}
 
-    if (left < heap->size && heap->nodes[left]->cost < heap->nodes[smallest]->cost) {
-        smallest = left;
+// Main function to process input and output
+int main(int argc, char **argv) {
+    size_t mem_budget = physical_memory();
+    bool verbose = false;
+    Engine engine = ENGINE_AUTO;
+    Kernel kernel = KERNEL_AUTO;
+    bool batch = false;
+    size_t window = DEFAULT_BATCH_WINDOW;
+    int threads = 1;
+    int landmark_count = 0;
+    LandmarkStrategy landmark_strategy = LANDMARKS_AVOID;
+    SearchConfig config = {0};
+    const char *convert_to = NULL;
+    bool verify = false;
+    bool use_oracle = false;
+    const char *oracle_file = NULL;
+    bool use_hierarchy = false;
+    bool reach_only = false;
+    bool reorder = false;
+    OrderStrategy order_strategy = ORDER_RCM;
+    bool stats = false;
+    const char *stats_file = NULL;
+    bool perf = false;
+    bool updates = false;
+    const char *perf_file = NULL;
+    const char *hot_list = NULL;
+    size_t cache_cap = 0;
+    bool profile = false;
+    bool matrix_mode = false;
+    MatrixFormat matrix_format = MATRIX_CSV;
+    const char *matrix_paths = NULL;
+
+    static const struct option long_options[] = {
+        {"batch", no_argument, NULL, 'b'},
+        {"threads", required_argument, NULL, 't'},
+        {"alt", required_argument, NULL, 'a'},
+        {"landmarks", required_argument, NULL, 'l'},
+        {"bidir", no_argument, NULL, 'B'},
+        {"convert", required_argument, NULL, 'c'},
+        {"verify", no_argument, NULL, 'V'},
+        {"oracle", no_argument, NULL, 'o'},
+        {"oracle-file", required_argument, NULL, 'O'},
+        {"ch", no_argument, NULL, 'C'},
+        {"reachable", no_argument, NULL, 'r'},
+        {"reorder", required_argument, NULL, 'R'},
+        {"stats", optional_argument, NULL, 'S'},
+        {"perf", optional_argument, NULL, 'P'},
+        {"updates", no_argument, NULL, 'u'},
+        {"hot", required_argument, NULL, 'H'},
+        {"cache", required_argument, NULL, 'K'},
+        {"profile", no_argument, NULL, 'p'},
+        {"matrix", optional_argument, NULL, 'x'},
+        {"matrix-paths", required_argument, NULL, 'X'},
+        {"window", required_argument, NULL, 'w'},
+        {"engine", required_argument, NULL, 'e'},
+        {"kernel", required_argument, NULL, 'k'},
+        {"mem-budget", required_argument, NULL, 'm'},
+        {"verbose", no_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "bt:w:a:l:Bc:VoO:CrR:S::P::uH:K:px::X:e:k:m:v", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'm':
+            if (parse_bytes(optarg, &mem_budget) != 0) {
+                fprintf(stderr, "Invalid memory budget: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'b':
+            batch = true;
+            break;
+        case 't':
+            threads = atoi(optarg);
+            if (threads < 1) {
+                fprintf(stderr, "Invalid thread count: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'a':
+            landmark_count = atoi(optarg);
+            if (landmark_count < 0) {
+                fprintf(stderr, "Invalid landmark count: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'l':
+            if (strcmp(optarg, "farthest") == 0) landmark_strategy = LANDMARKS_FARTHEST;
+            else if (strcmp(optarg, "avoid") == 0) landmark_strategy = LANDMARKS_AVOID;
+            else {
+                fprintf(stderr, "Unknown landmark strategy: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'B':
+            config.bidirectional = true;
+            break;
+        case 'c':
+            convert_to = optarg;
+            break;
+        case 'V':
+            verify = true;
+            break;
+        case 'o':
+            use_oracle = true;
+            break;
+        case 'O':
+            use_oracle = true;
+            oracle_file = optarg;
+            break;
+        case 'C':
+            use_hierarchy = true;
+            break;
+        case 'r':
+            reach_only = true;
+            break;
+        case 'R':
+            reorder = strcmp(optarg, "none") != 0;
+            if (strcmp(optarg, "bfs") == 0) order_strategy = ORDER_BFS;
+            else if (strcmp(optarg, "rcm") == 0) order_strategy = ORDER_RCM;
+            else if (reorder) {
+                fprintf(stderr, "Unknown vertex order: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'S':
+            stats = true;
+            stats_file = optarg;
+            break;
+        case 'P':
+            perf = true;
+            perf_file = optarg;
+            break;
+        case 'u':
+            updates = true;
+            break;
+        case 'H':
+            hot_list = optarg;
+            break;
+        case 'p':
+            profile = true;
+            break;
+        case 'x':
+            matrix_mode = true;
+            if (!optarg || strcmp(optarg, "csv") == 0) matrix_format = MATRIX_CSV;
+            else if (strcmp(optarg, "binary") == 0) matrix_format = MATRIX_BINARY;
+            else {
+                fprintf(stderr, "Unknown matrix format: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'X':
+            matrix_paths = optarg;
+            break;
+        case 'K':
+            if (parse_bytes(optarg, &cache_cap) != 0 || cache_cap == 0) {
+                fprintf(stderr, "Invalid cache size: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'w': {
+            char *end;
+            window = strtoull(optarg, &end, 10);
+            if (end == optarg || *end != '\0') {
+                fprintf(stderr, "Invalid window: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case 'e':
+            if (strcmp(optarg, "auto") == 0) engine = ENGINE_AUTO;
+            else if (strcmp(optarg, "heap") == 0) engine = ENGINE_HEAP;
+            else if (strcmp(optarg, "dial") == 0) engine = ENGINE_DIAL;
+            else if (strcmp(optarg, "radix") == 0) engine = ENGINE_RADIX;
+            else {
+                fprintf(stderr, "Unknown engine: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'k':
+            if (strcmp(optarg, "auto") == 0) kernel = KERNEL_AUTO;
+            else if (strcmp(optarg, "scalar") == 0) kernel = KERNEL_SCALAR;
+            else if (strcmp(optarg, "sse4") == 0) kernel = KERNEL_SSE4;
+            else if (strcmp(optarg, "avx2") == 0) kernel = KERNEL_AVX2;
+            else {
+                fprintf(stderr, "Unknown kernel: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
     }
 
-    if (right < heap->size && heap->nodes[right]->cost < heap->nodes[smallest]->cost) {
-        smallest = right;
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
     }
-
-    if (smallest != idx) {
-        swap(&heap->nodes[idx], &heap->nodes[smallest]);
-        heapify_down(heap, smallest);
+    if (stats && !STATS_COMPILED) {
+        fprintf(stderr, "--stats needs the search counters: rebuild with make clean && make STATS=1\n");
+        return EXIT_FAILURE;
     }
-}
-
-void insert_min_heap(MinHeap *heap, Node *node) {
-    if (heap->size < MAX_VERTICES * 10) {
-        heap->nodes[heap->size] = node;
-        heapify_up(heap, heap->size++);
+    // Both write one line per query to a single log
+    if (stats_file && perf_file && strcmp(stats_file, perf_file) != 0) {
+        fprintf(stderr, "--stats and --perf share one log; give at most one file\n");
+        return EXIT_FAILURE;
     }
-}
-
-Node *extract_min(MinHeap *heap) {
-    if (!heap->size) return NULL;
-    Node *root = heap->nodes[0];
-    heap->nodes[0] = heap->nodes[--heap->size];
-    heapify_down(heap, 0);
-    return root;
-}
-
-// Dijkstra's algorithm with periodic weights
-int *dijkstra(Graph *graph, int start, int end, int *path_len) {
-    int V = graph->V;
-    int N = graph->N;
-
-    // 2D array to store distances for each vertex at each step
-    int dist[V][N];
-    int prev[V][N];
-    bool visited[V][N];
-
-    for (int i = 0; i < V; i++) {
-        for (int j = 0; j < N; j++) {
-            dist[i][j] = INF;
-            prev[i][j] = -1;
-            visited[i][j] = false;
+    if (config.bidirectional + (landmark_count > 0) + use_oracle + use_hierarchy > 1) {
+        fprintf(stderr, "--bidir, --alt, --oracle and --ch cannot be combined\n");
+        return EXIT_FAILURE;
+    }
+    // Oracle answers walk precomputed tables, with no search to count
+    if (stats && use_oracle) {
+        fprintf(stderr, "--stats cannot be combined with --oracle\n");
+        return EXIT_FAILURE;
+    }
+    if (updates && (batch || landmark_count > 0 || use_oracle || use_hierarchy || reach_only)) {
+        fprintf(stderr, "--updates cannot be combined with --batch, --alt, --oracle, --ch or --reachable\n");
+        return EXIT_FAILURE;
+    }
+    // Cached labels are plain Dijkstra labels on a fixed graph
+    if (cache_cap && (batch || config.bidirectional || landmark_count > 0 || use_oracle ||
+                      use_hierarchy || updates)) {
+        fprintf(stderr, "--cache cannot be combined with --batch, --bidir, --alt, --oracle, --ch or --updates\n");
+        return EXIT_FAILURE;
+    }
+    if (profile && (batch || config.bidirectional || landmark_count > 0 || use_oracle ||
+                    use_hierarchy || cache_cap || hot_list || reach_only)) {
+        fprintf(stderr, "--profile cannot be combined with --batch, --bidir, --alt, --oracle, --ch, --cache, --hot or --reachable\n");
+        return EXIT_FAILURE;
+    }
+    // Matrix rows are multi-target searches on the plain graph
+    if (matrix_mode && (batch || config.bidirectional || landmark_count > 0 || use_oracle ||
+                        use_hierarchy || updates || cache_cap || profile ||
+                        reach_only || stats || perf)) {
+        fprintf(stderr, "--matrix cannot be combined with --batch, --bidir, --alt, --oracle, --ch, --updates, --cache, --profile, --reachable, --stats or --perf\n");
+        return EXIT_FAILURE;
+    }
+    if (matrix_paths && !matrix_mode) {
+        fprintf(stderr, "--matrix-paths needs --matrix\n");
+        return EXIT_FAILURE;
+    }
+    if (hot_list && !updates) {
+        fprintf(stderr, "--hot keeps trees across updates and needs --updates\n");
+        return EXIT_FAILURE;
+    }
+    config.engine = engine;
+    config.profile = profile;
+    // A hierarchy query searches backwards too; size it like --bidir
+    SearchConfig sizing = config;
+    if (use_hierarchy) sizing.bidirectional = true;
+
+    Graph *graph = NULL;
+    if (is_snapshot(argv[optind])) {
+        // Binary snapshot: map it and use the arrays in place
+        graph = load_snapshot(argv[optind], verify);
+        if (!graph) return EXIT_FAILURE;
+        if (check_budget(graph->V, graph->N, &sizing, threads, mem_budget, verbose) != 0) {
+            free_graph(graph);
+            return EXIT_FAILURE;
         }
+    } else {
+        // Text edge list: map it, check the header, then parse in parallel
+        TextGraph *text = open_text_graph(argv[optind]);
+        if (!text) return EXIT_FAILURE;
+        if (check_budget(text->V, text->N, &sizing, threads, mem_budget, verbose) != 0) {
+            close_text_graph(text);
+            return EXIT_FAILURE;
+        }
+        graph = parse_text_graph(text, online_cpus());
+        close_text_graph(text);
+        if (!graph) return EXIT_FAILURE;
     }
 
-    // Initialize the starting vertex
-    dist[start][0] = 0;
-
-    MinHeap *heap = create_min_heap();
-    insert_min_heap(heap, new_node(start, 0, 0)); // Push start node into heap
-
-    while (heap->size > 0) {
-        Node *current = extract_min(heap);
-        int u = current->vertex;
-        int step = current->step % N;
-        int current_cost = current->cost;
-        free(current);
-
-        if (visited[u][step]) continue;
-        visited[u][step] = true;
-
-        if (u == end) break;
-
-        // Explore neighbors
-        Edge *edge = graph->adj[u];
-        while (edge) {
-            int v = edge->target;
-            int next_step = (step + 1) % N;
-            int weight = edge->weights[step];
-            int new_cost = current_cost + weight;
-            if (v >= 0 && v < V && next_step >= 0 && next_step < N) {
-                if (new_cost < dist[v][next_step]) {
-                    dist[v][next_step] = new_cost;
-                    prev[v][next_step] = u;
-                    insert_min_heap(heap, new_node(v, next_step, new_cost));
-                }
-            }
-            edge = edge->next;
+    if (convert_to) {
+        int status = save_snapshot(graph, convert_to);
+        if (status == 0 && verbose) {
+            fprintf(stderr, "wrote %d vertices, %lld edges to %s\n",
+                    graph->V, (long long)graph->E, convert_to);
         }
+        free_graph(graph);
+        return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
-    // Find the minimum cost to reach the end node across all steps
-    int min_cost = INF;
-    int final_step = -1;
-    for (int i = 0; i < N; i++) {
-        if (dist[end][i] < min_cost) {
-            min_cost = dist[end][i];
-            final_step = i;
+    // Everything built from here on is released at done
+    int status = EXIT_FAILURE;
+    Ordering *ordering = NULL;
+    StatsLog *stats_log = NULL;
+    Reachability *reach = NULL;
+    Oracle *oracle = NULL;
+    Hierarchy *hierarchy = NULL;
+    Landmarks *landmarks = NULL;
+    Workspace *ws = NULL;
+    Pool *pool = NULL;
+    int *hot_sources = NULL;
+    int hot_count = 0;
+    HotTrees *hot = NULL;
+    SearchCache *cache = NULL;
+    Matrix *matrix = NULL;
+
+    // Everything below, including saved oracles, sees the
+    // renumbered graph; only the query ids are translated
+    if (reorder) {
+        double began = seconds();
+        ordering = build_ordering(graph, order_strategy);
+        if (!ordering || apply_ordering(graph, ordering) != 0) goto done;
+        config.ordering = ordering;
+        if (verbose) {
+            fprintf(stderr, "renumbered %d vertices in %.3fs\n", graph->V, seconds() - began);
         }
     }
 
-    if (min_cost == INF) {
-        *path_len = 0;
-        return NULL;
+    config.engine = select_engine(engine, graph->min_weight, graph->max_weight);
+    config.kernel = select_kernel(kernel);
+    // Updated weights may outgrow Dial's buckets, sized from the loaded graph
+    if (updates && config.engine == ENGINE_DIAL) config.engine = ENGINE_RADIX;
+    // A profile pop can lower a dearer departure's cost past Dial's window
+    if (profile && config.engine == ENGINE_DIAL) config.engine = ENGINE_RADIX;
+    if (hot_list) {
+        if (parse_vertices(hot_list, &hot_sources, &hot_count) != 0) {
+            fprintf(stderr, "Invalid hot source list: %s\n", hot_list);
+            goto done;
+        }
+        for (int i = 0; i < hot_count; i++) {
+            if (hot_sources[i] >= graph->V) {
+                fprintf(stderr, "Hot source %d is not a vertex\n", hot_sources[i]);
+                goto done;
+            }
+            if (ordering) hot_sources[i] = ordering->to_inner[hot_sources[i]];
+        }
+        size_t tree_bytes = hot_tree_bytes(graph->V, graph->N, hot_count);
+        if (tree_bytes > mem_budget) {
+            fprintf(stderr, "Hot trees need %zu bytes, over the memory budget of %zu\n",
+                    tree_bytes, mem_budget);
+            goto done;
+        }
     }
-
-    // Reconstruct the path
-    int *path = malloc(V * sizeof(int));
-    *path_len = 0;
-
-    for (int at = end, step = final_step; at != -1; step = (step - 1 + N) % N) {
-        path[(*path_len)++] = at;
-        at = prev[at][step];
+    // Bidirectional searches walk the in-edges, and tree repairs relabel
+    // from them
+    if ((config.bidirectional || hot_list) && graph_build_reverse(graph) != 0) goto done;
+
+    // Reject unreachable queries without a search
+    reach = build_reachability(graph, mem_budget);
+    if (!reach) goto done;
+    config.reach = reach;
+    if (verbose) {
+        fprintf(stderr, "%d strongly connected components, %s\n", reach->components,
+                reach->closure ? "closure kept" : "interval labels only");
     }
-
-    // Reverse the path to get start → end
-    for (int i = 0; i < *path_len / 2; i++) {
-        int temp = path[i];
-        path[i] = path[*path_len - i - 1];
-        path[*path_len - i - 1] = temp;
+    if (reach_only) {
+        Query query;
+        ReachScratch scratch = {0};
+        while (read_queries(stdin, &query, 1) == 1) {
+            bool in_range = query.start >= 0 && query.start < graph->V && query.end >= 0 && query.end < graph->V;
+            if (in_range && ordering) {
+                query.start = ordering->to_inner[query.start];
+                query.end = ordering->to_inner[query.end];
+            }
+            puts(in_range && reaches(reach, &scratch, query.start, query.end) ? "Reachable" : "Unreachable");
+        }
+        free_reach_scratch(&scratch);
+        status = EXIT_SUCCESS;
+        goto done;
     }
 
-    return path;
-}
-void free_graph(Graph *graph) {
-    for (int i = 0; i < graph->V; ++i) {
-        Edge *edge = graph->adj[i];
-        while (edge) {
-            Edge *temp = edge;
-            edge = edge->next;
-            free(temp->weights);
-            free(temp);
+    if (use_oracle) {
+        if (oracle_file) oracle = load_oracle(graph, oracle_file);
+        if (!oracle) {
+            // Tables are V x V costs plus V x V x N next hops, on top of
+            // one search state per building thread
+            size_t table_bytes = oracle_bytes(graph);
+            size_t build_bytes = table_bytes + search_state_bytes(graph->V, graph->N, &config) * online_cpus();
+            if (verbose) {
+                fprintf(stderr, "oracle tables need %zu bytes (budget %zu)\n", table_bytes, mem_budget);
+            }
+            if (build_bytes > mem_budget) {
+                fprintf(stderr, "Oracle needs %zu bytes, over the memory budget of %zu\n",
+                        build_bytes, mem_budget);
+                goto done;
+            }
+            oracle = build_oracle(graph, config.engine, online_cpus());
+            if (!oracle) {
+                goto done;
+            }
+            if (oracle_file && save_oracle(oracle, graph, oracle_file) == 0 && verbose) {
+                fprintf(stderr, "saved oracle to %s\n", oracle_file);
+            }
+        } else if (verbose) {
+            fprintf(stderr, "loaded oracle from %s\n", oracle_file);
         }
+        config.oracle = oracle;
     }
-    free(graph);
-}
 
-void free_heap(MinHeap *heap) {
-    for (int i = 0; i < heap->size; ++i) {
-        free(heap->nodes[i]);
+    if (use_hierarchy) {
+        hierarchy = build_hierarchy(graph);
+        if (!hierarchy) {
+            goto done;
+        }
+        config.hierarchy = hierarchy;
+        // Shortcuts cost more than the largest edge weight that sizes
+        // Dial's buckets
+        if (config.engine == ENGINE_DIAL) config.engine = ENGINE_RADIX;
+        if (verbose) {
+            fprintf(stderr, "hierarchy has %d arcs, %d of them shortcuts (%.1f per input edge), "
+                    "%d vertices left in the core\n",
+                    hierarchy->arc_count, hierarchy->shortcut_count,
+                    graph->E ? (double)hierarchy->shortcut_count / graph->E : 0.0,
+                    hierarchy->V - hierarchy->core_rank);
+        }
     }
-    free(heap);
-}
 
-
-// Main function to process input and output
-int main(int argc, char **argv) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
-        return EXIT_FAILURE;
+    if (landmark_count > 0) {
+        landmarks = build_landmarks(graph, landmark_count, landmark_strategy);
+        if (!landmarks) {
+            goto done;
+        }
+        config.landmarks = landmarks;
+        // A* keys can jump by more than one weight, which Dial's circular
+        // buckets cannot hold; the radix heap only needs monotone keys
+        if (config.engine == ENGINE_DIAL) config.engine = ENGINE_RADIX;
+        if (verbose) {
+            fprintf(stderr, "%d landmarks:", landmarks->count);
+            for (int i = 0; i < landmarks->count; i++) fprintf(stderr, " %d", landmarks->vertices[i]);
+            fprintf(stderr, "\n");
+        }
     }
-
-    FILE *file = fopen(argv[1], "r");
-    if (!file) {
-        perror("Error opening file");
-        return EXIT_FAILURE;
+    if (verbose) {
+        fprintf(stderr, "weights %d..%d, using the %s engine and the %s kernel\n",
+                graph->min_weight, graph->max_weight, engine_name(config.engine),
+                kernel_name(config.kernel));
     }
 
-    int V, N;
-    if (fscanf(file, "%d %d", &V, &N) != 2) {
-        fprintf(stderr, "Invalid input format\n");
-        fclose(file);
-        return EXIT_FAILURE;
+    // --stats and --perf share one log, and one line per query
+    if (stats || perf) {
+        stats_log = open_stats_log(stats_file ? stats_file : perf_file, STATS_COMPILED);
+        if (!stats_log) goto done;
+        config.perf = perf;
     }
 
-    Graph *graph = create_graph(V, N);
-
-    while (!feof(file)) {
-        int src, dest;
-        int *weights = malloc(N * sizeof(int));
-        if (fscanf(file, "%d %d", &src, &dest) != 2) break;
-        for (int i = 0; i < N; ++i) {
-            if (fscanf(file, "%d", &weights[i]) != 1) {
-                fprintf(stderr, "Error reading weights\n");
-                free(weights);
-                fclose(file);
-                free_graph(graph);
-                return EXIT_FAILURE;
-            }
+    if (cache_cap) {
+        size_t state_bytes = search_state_bytes(graph->V, graph->N, &config) * threads;
+        if (cache_cap > mem_budget || state_bytes > mem_budget - cache_cap) {
+            fprintf(stderr, "Search cache of %zu bytes does not fit the memory budget of %zu\n",
+                    cache_cap, mem_budget);
+            goto done;
         }
-        add_edge(graph, src, dest, weights);
+        cache = create_search_cache(graph->V, cache_cap);
+        if (!cache) {
+            fprintf(stderr, "Out of memory creating search cache\n");
+            goto done;
+        }
+        config.cache = cache;
     }
 
-    fclose(file);
+    // One workspace for the main thread, or a pool of workers that each
+    // own one
+    if (threads > 1) {
+        pool = create_pool(graph, &config, threads);
+    } else {
+        ws = create_workspace(graph, &config);
+    }
+    if (!ws && !pool) {
+        fprintf(stderr, "Out of memory allocating search workspace\n");
+        goto done;
+    }
 
-    int start, end;
-    while (scanf("%d %d", &start, &end) == 2) {
-        int path_len;
-        int *path = dijkstra(graph, start, end, &path_len);
-        if (path) {
-            for (int i = 0; i < path_len; i++) {
-                if (i > 0) printf(" ");
-                printf("%d", path[i]);
+    if (updates) {
+        GraphVersion *version = initial_version(graph, reach);
+        if (!version) goto done;
+        if (hot_list) {
+            double began = seconds();
+            hot = build_hot_trees(version, hot_sources, hot_count, config.engine);
+            if (!hot) {
+                fprintf(stderr, "Out of memory building hot trees\n");
+                release_version(version);
+                goto done;
             }
-            printf("\n");
-            free(path);
+            config.hot = hot;
+            if (verbose) fprintf(stderr, "%d hot trees built in %.3fs\n", hot->count, seconds() - began);
+        }
+        if (serve_with_updates(ws, pool, version, hot, ordering, mem_budget, stats_log, verbose) != 0) {
+            goto done;
+        }
+    } else if (matrix_mode) {
+        // The costs share the budget with the workers' search state
+        size_t state_bytes = search_state_bytes(graph->V, graph->N, &config) * threads;
+        size_t left = mem_budget > state_bytes ? mem_budget - state_bytes : 0;
+        matrix = read_matrix(stdin, graph->V, matrix_paths != NULL, left);
+        if (!matrix) goto done;
+        FILE *paths_out = NULL;
+        if (matrix_paths && !(paths_out = fopen(matrix_paths, "w"))) {
+            perror(matrix_paths);
+            goto done;
+        }
+        double began = seconds();
+        if (pool) {
+            pool_answer_matrix(pool, matrix);
         } else {
-            printf("No path found\n");
+            answer_matrix(ws, matrix);
+        }
+        if (verbose) {
+            fprintf(stderr, "%d x %d matrix in %.3fs\n", matrix->rows, matrix->cols, seconds() - began);
+        }
+        int written = write_matrix(stdout, matrix, matrix_format);
+        if (paths_out) {
+            if (written == 0) written = write_matrix_paths(paths_out, matrix);
+            if (fclose(paths_out) != 0) written = -1;
+        }
+        if (written != 0) goto done;
+    } else if (batch) {
+        // Read a window (or everything), answer it grouped by start, and
+        // print in input order
+        Query *queries = NULL;
+        size_t capacity = 1024;
+        size_t count;
+        while ((count = read_window(stdin, &queries, &capacity, window)) > 0) {
+            if (pool) {
+                pool_answer_batch(pool, queries, count);
+            } else {
+                answer_batch(ws, queries, count);
+            }
+            for (size_t i = 0; i < count; i++) {
+                print_answer(stdout, &queries[i]);
+                if (stats_log) log_query_stats(stats_log, &queries[i]);
+            }
+            release_answers(queries, count);
+            if (!window) break;
+        }
+        free(queries);
+    } else if (pool) {
+        pool_stream(pool, stdin, stdout, stats_log);
+    } else {
+        Query query;
+        while (read_queries(stdin, &query, 1) == 1) {
+            answer_query(ws, &query);
+            print_answer(stdout, &query);
+            if (stats_log) log_query_stats(stats_log, &query);
+            release_answers(&query, 1);
         }
     }
 
+    status = EXIT_SUCCESS;
+
+done:
+    if (pool) free_pool(pool);
+    if (matrix) free_matrix(matrix);
+    if (ws) free_workspace(ws);
+    if (hot) free_hot_trees(hot);
+    if (cache) {
+        if (verbose) report_search_cache(cache, stderr);
+        free_search_cache(cache);
+    }
+    free(hot_sources);
+    if (landmarks) free_landmarks(landmarks);
+    if (oracle) free_oracle(oracle);
+    if (hierarchy) free_hierarchy(hierarchy);
+    if (reach) free_reachability(reach);
+    if (ordering) free_ordering(ordering);
+    if (stats_log) close_stats_log(stats_log);
     free_graph(graph);
-    return EXIT_SUCCESS;
+    return status;
 }
-
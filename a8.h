@@ -0,0 +1,41 @@
+#ifndef A8_H
+#define A8_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Cost of an unreached state
+#define INF INT_MAX
+
+// Sum of two non-negative costs, saturating at INF
+static inline int add_costs(int x, int y) {
+    long long sum = (long long)x + y;
+    return sum >= INF ? INF : (int)sum;
+}
+
+// Growable array of ints, such as arc ids or the vertices of a path
+typedef struct IntList {
+    int *items;
+    int count;
+    int capacity;
+} IntList;
+
+static inline int list_push(IntList *list, int item) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 4;
+        int *items = realloc(list->items, capacity * sizeof(int));
+        if (!items) return -1;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = item;
+    return 0;
+}
+
+// Round a file offset up to align, a power of two
+static inline uint64_t align_up(uint64_t at, uint64_t align) {
+    return (at + align - 1) & ~(align - 1);
+}
+
+#endif // A8_H
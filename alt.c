@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alt.h"
+#include "heap.h"
+
+#define LANDMARK_SEED 0xa8a8a8a8u
+
+// Vertex-level Dijkstra over a CSR with one weight per edge, writing
+// distances (INF when unreached) and, optionally, tree parents
+static void lower_bound_sssp(const int64_t *offsets, const int *adjacent, const int *lower,
+                             int V, int source, int *dist, int *parent, MinHeap *heap) {
+    for (int v = 0; v < V; v++) {
+        dist[v] = INF;
+        if (parent) parent[v] = -1;
+    }
+    clear_min_heap(heap);
+    dist[source] = 0;
+    insert_or_decrease(heap, source, 0);
+
+    HeapEntry current;
+    while (extract_min(heap, &current)) {
+        int u = current.state;
+        for (int64_t e = offsets[u]; e < offsets[u + 1]; e++) {
+            int v = adjacent[e];
+            int new_cost = current.key + lower[e];
+            if (new_cost < dist[v]) {
+                dist[v] = new_cost;
+                if (parent) parent[v] = u;
+                insert_or_decrease(heap, v, new_cost);
+            }
+        }
+    }
+}
+
+// Minimum over phases of each edge weight, for a phase-major weight block
+static int *phase_minimum(const int *weights, int N, int64_t E) {
+    int *lower = malloc((E ? E : 1) * sizeof(int));
+    if (!lower) return NULL;
+    for (int64_t e = 0; e < E; e++) lower[e] = weights[e];
+    for (int p = 1; p < N; p++) {
+        const int *phase = weights + (size_t)p * E;
+        for (int64_t e = 0; e < E; e++) {
+            if (phase[e] < lower[e]) lower[e] = phase[e];
+        }
+    }
+    return lower;
+}
+
+// ALT lower bound on the cost from v to t, or INF if the tables prove
+// that v cannot reach t
+int alt_bound(const Landmarks *landmarks, int v, int t) {
+    int k = landmarks->count;
+    const int *from_v = landmarks->from + (size_t)v * k;
+    const int *from_t = landmarks->from + (size_t)t * k;
+    const int *to_v = landmarks->to + (size_t)v * k;
+    const int *to_t = landmarks->to + (size_t)t * k;
+    int best = 0;
+
+    for (int i = 0; i < k; i++) {
+        // d(L, t) - d(L, v); L reaching v but not t means v cannot reach t
+        if (from_t[i] != INF) {
+            if (from_v[i] != INF && from_t[i] - from_v[i] > best) best = from_t[i] - from_v[i];
+        } else if (from_v[i] != INF) {
+            return INF;
+        }
+        // d(v, L) - d(t, L); t reaching L but not v means v cannot reach t
+        if (to_t[i] != INF) {
+            if (to_v[i] == INF) return INF;
+            if (to_v[i] - to_t[i] > best) best = to_v[i] - to_t[i];
+        }
+    }
+    return best;
+}
+
+// Farthest strategy: the vertex whose nearest chosen landmark is farthest
+// away, counting vertices no landmark reaches as infinitely far
+static int pick_farthest(const Landmarks *landmarks, int chosen, int V, const int *root_dist) {
+    int best = -1;
+    long long best_score = -1;
+    for (int v = 0; v < V; v++) {
+        long long score;
+        if (chosen == 0) {
+            // First landmark: farthest reachable vertex from the root
+            score = root_dist[v] == INF ? -1 : root_dist[v];
+        } else {
+            score = LLONG_MAX;
+            for (int i = 0; i < chosen; i++) {
+                int d = landmarks->from[(size_t)v * landmarks->count + i];
+                long long s = d == INF ? LLONG_MAX - 1 : d;
+                if (landmarks->vertices[i] == v) s = -1;
+                if (s < score) score = s;
+            }
+        }
+        if (score > best_score) {
+            best_score = score;
+            best = v;
+        }
+    }
+    return best;
+}
+
+// Tree vertex keyed by its root distance
+typedef struct TreeKey {
+    int dist;
+    int vertex;
+} TreeKey;
+
+static int compare_deepest_first(const void *a, const void *b) {
+    const TreeKey *x = a;
+    const TreeKey *y = b;
+    if (x->dist != y->dist) return x->dist > y->dist ? -1 : 1;
+    return x->vertex - y->vertex;
+}
+
+// Avoid strategy: grow a shortest-path tree from a random root, weigh each
+// vertex by how much the current bound underestimates its distance, and
+// descend from the heaviest subtree without a landmark to one of its leaves
+static int pick_avoid(const Landmarks *landmarks, int chosen, int V, int root,
+                      const int *root_dist, const int *parent) {
+    long long *size = calloc(V, sizeof(long long));
+    TreeKey *order = malloc(V * sizeof(TreeKey));
+    bool *covered = calloc(V, sizeof(bool));
+    int64_t *child_start = calloc((size_t)V + 1, sizeof(int64_t));
+    int *children = malloc(V * sizeof(int));
+    int pick = -1;
+    if (!size || !order || !covered || !child_start || !children) goto done;
+
+    // Reached vertices, deepest first, so children are summed before parents
+    int reached = 0;
+    for (int v = 0; v < V; v++) {
+        if (root_dist[v] != INF) {
+            order[reached].dist = root_dist[v];
+            order[reached].vertex = v;
+            reached++;
+        }
+    }
+    qsort(order, reached, sizeof(TreeKey), compare_deepest_first);
+
+    for (int i = 0; i < chosen; i++) covered[landmarks->vertices[i]] = true;
+    for (int i = 0; i < reached; i++) {
+        int v = order[i].vertex;
+        int bound = chosen ? alt_bound(landmarks, root, v) : 0;
+        if (bound == INF) bound = 0;
+        size[v] += root_dist[v] - bound;
+        if (parent[v] >= 0) {
+            if (covered[v]) covered[parent[v]] = true;
+            child_start[parent[v] + 1]++;
+        }
+    }
+    for (int i = 0; i < reached; i++) {
+        int v = order[i].vertex;
+        if (covered[v]) size[v] = 0;
+        if (parent[v] >= 0 && !covered[parent[v]]) size[parent[v]] += size[v];
+    }
+    for (int v = 0; v < V; v++) child_start[v + 1] += child_start[v];
+    int64_t *fill = malloc(((size_t)V + 1) * sizeof(int64_t));
+    if (!fill) goto done;
+    memcpy(fill, child_start, ((size_t)V + 1) * sizeof(int64_t));
+    for (int v = 0; v < V; v++) {
+        if (root_dist[v] != INF && parent[v] >= 0) children[fill[parent[v]]++] = v;
+    }
+    free(fill);
+
+    int w = -1;
+    for (int v = 0; v < V; v++) {
+        if (size[v] > 0 && (w < 0 || size[v] > size[w])) w = v;
+    }
+    while (w >= 0) {
+        int next = -1;
+        for (int64_t c = child_start[w]; c < child_start[w + 1]; c++) {
+            int child = children[c];
+            if (size[child] > 0 && (next < 0 || size[child] > size[next])) next = child;
+        }
+        if (next < 0) break;
+        w = next;
+    }
+    pick = w;
+
+done:
+    free(size);
+    free(order);
+    free(covered);
+    free(child_start);
+    free(children);
+    return pick;
+}
+
+// Choose count landmarks and fill their lower-bound distance tables
+Landmarks *build_landmarks(Graph *graph, int count, LandmarkStrategy strategy) {
+    int V = graph->V;
+    if (count > V) count = V;
+    if (graph_build_reverse(graph) != 0) return NULL;
+
+    Landmarks *landmarks = calloc(1, sizeof(Landmarks));
+    int *lower = phase_minimum(graph->weights, graph->N, graph->E);
+    int *rev_lower = phase_minimum(graph->rev_weights, graph->N, graph->E);
+    int *dist = malloc(V * sizeof(int));
+    int *parent = malloc(V * sizeof(int));
+    MinHeap *heap = create_min_heap(V);
+    if (landmarks) {
+        landmarks->count = count;
+        landmarks->vertices = malloc(count * sizeof(int));
+        landmarks->from = malloc((size_t)V * count * sizeof(int));
+        landmarks->to = malloc((size_t)V * count * sizeof(int));
+    }
+    if (!landmarks || !landmarks->vertices || !landmarks->from || !landmarks->to ||
+        !lower || !rev_lower || !dist || !parent || !heap) {
+        fprintf(stderr, "Out of memory building landmarks\n");
+        if (landmarks) free_landmarks(landmarks);
+        landmarks = NULL;
+        goto done;
+    }
+
+    unsigned seed = LANDMARK_SEED;
+    for (int i = 0; i < count; i++) {
+        int root = rand_r(&seed) % V;
+        lower_bound_sssp(graph->offsets, graph->targets, lower, V, root, dist, parent, heap);
+
+        int pick = -1;
+        if (strategy == LANDMARKS_AVOID) {
+            pick = pick_avoid(landmarks, i, V, root, dist, parent);
+        }
+        if (pick < 0) pick = pick_farthest(landmarks, i, V, dist);
+        landmarks->vertices[i] = pick;
+
+        lower_bound_sssp(graph->offsets, graph->targets, lower, V, pick, dist, NULL, heap);
+        for (int v = 0; v < V; v++) landmarks->from[(size_t)v * count + i] = dist[v];
+        lower_bound_sssp(graph->rev_offsets, graph->rev_sources, rev_lower, V, pick, dist, NULL, heap);
+        for (int v = 0; v < V; v++) landmarks->to[(size_t)v * count + i] = dist[v];
+    }
+
+done:
+    free(lower);
+    free(rev_lower);
+    free(dist);
+    free(parent);
+    if (heap) free_heap(heap);
+    return landmarks;
+}
+
+void free_landmarks(Landmarks *landmarks) {
+    free(landmarks->vertices);
+    free(landmarks->from);
+    free(landmarks->to);
+    free(landmarks);
+}
+
+// Cached ALT bound of vertex v towards the current target
+static inline int heuristic(Workspace *ws, int v, int end) {
+    if (ws->heur_stamp[v] != ws->gen) {
+        ws->heur_stamp[v] = ws->gen;
+        ws->heur[v] = alt_bound(ws->config->landmarks, v, end);
+    }
+    return ws->heur[v];
+}
+
+// A* over (vertex, phase) states from (start, phase), ordered by cost +
+// ALT bound. The bound is
+// consistent, so the first settled phase of end is optimal; vertices the
+// tables prove cannot reach end are never queued.
+int *alt_search(Workspace *ws, int start, int phase, int end, int *path_len) {
+    const Graph *graph = ws->graph;
+    int N = graph->N;
+    int *dist = ws->dist;
+    int *prev = ws->prev;
+    uint32_t *stamp = ws->stamp;
+    Queue *queue = ws->queue;
+
+    begin_search(ws);
+    uint32_t labelled = ws->gen;
+    uint32_t settled = ws->gen + 1;
+
+    *path_len = 0;
+    int h_start = heuristic(ws, start, end);
+    if (h_start == INF) return NULL;
+
+    size_t origin = (size_t)start * N + phase;
+    dist[origin] = 0;
+    prev[origin] = -1;
+    stamp[origin] = labelled;
+    queue_push(queue, origin, h_start);
+    STAT_ADD(ws->stats, pushes, 1);
+
+    HeapEntry current;
+    while (pop_state(queue, &current)) {
+        size_t s = current.state;
+        STAT_ADD(ws->stats, pops, 1);
+        if (stamp[s] == settled) {
+            STAT_ADD(ws->stats, stale_pops, 1);
+            continue;
+        }
+        stamp[s] = settled;
+        STAT_ADD(ws->stats, settled, 1);
+
+        int u = s / N;
+        if (u == end) break;
+        int step = s % N;
+        int current_cost = dist[s];
+
+        int next_step = (step + 1) % N;
+        const int *weights = graph->weights + (size_t)step * graph->E;
+        STAT_ADD(ws->stats, relaxations, graph->offsets[u + 1] - graph->offsets[u]);
+        STAT_MAX(ws->stats, max_queue, queue_size(queue));
+        for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            int v = graph->targets[e];
+            int new_cost = current_cost + weights[e];
+            size_t t = (size_t)v * N + next_step;
+            if (stamp[t] < labelled || (stamp[t] == labelled && new_cost < dist[t])) {
+                int h = heuristic(ws, v, end);
+                if (h == INF) continue;
+                dist[t] = new_cost;
+                prev[t] = u;
+                stamp[t] = labelled;
+                STAT_ADD(ws->stats, improvements, 1);
+                STAT_ADD(ws->stats, pushes, 1);
+                if (queue_push(queue, t, new_cost + h) != 0) {
+                    fprintf(stderr, "Out of memory growing queue\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+
+    return extract_path(ws, end, path_len);
+}
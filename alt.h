@@ -0,0 +1,32 @@
+#ifndef ALT_H
+#define ALT_H
+
+#include "a8.h"
+#include "graph.h"
+#include "search.h"
+
+// How landmark vertices are picked
+typedef enum LandmarkStrategy {
+    LANDMARKS_FARTHEST,  // Greedily farthest from those already chosen
+    LANDMARKS_AVOID      // Goldberg-Werneck "avoid": leaf of the worst-covered subtree
+} LandmarkStrategy;
+
+// Landmark distances on the lower-bound graph, where every edge weighs the
+// minimum of its N phase weights. Any walk in the (vertex, phase) graph
+// costs at least its lower-bound distance, so triangle-inequality bounds
+// from these tables are admissible and consistent for every phase.
+// Tables are vertex-major: from[v * count + i] is the distance from
+// landmark i to v, to[v * count + i] the distance from v to landmark i.
+typedef struct Landmarks {
+    int count;
+    int *vertices;       // Landmark vertex ids
+    int *from;
+    int *to;
+} Landmarks;
+
+Landmarks *build_landmarks(Graph *graph, int count, LandmarkStrategy strategy);
+void free_landmarks(Landmarks *landmarks);
+int alt_bound(const Landmarks *landmarks, int v, int t);
+int *alt_search(Workspace *ws, int start, int phase, int end, int *path_len);
+
+#endif // ALT_H
@@ -0,0 +1,453 @@
+// Check the answers a8 printed against plain dijkstra() on the same graph
+//
+//   check --write [--queries Q] [--updates | --matrix] [--seed S] <graph>
+//   check [--profile | --matrix] <graph> <stream> <answers>
+//
+// --write prints a stream of Q "start end phase" queries, and with
+// --updates mixes U/I/D updates between them and sends every other query
+// from one of the first HOT_SOURCES vertices in phase 0, where --hot trees
+// answer. With --matrix it prints a line of MATRIX_SIDE sources and one of
+// MATRIX_SIDE targets instead.
+//
+// The second form replays the stream, applying its updates in order, and
+// checks each answer line: "No path found" exactly when dijkstra() finds
+// none, and otherwise a path from start to end whose cost from the
+// departure phase, taking the cheapest parallel edge at each hop, equals
+// that of dijkstra()'s path. --profile answers carry N such lines per
+// query, "k cost: path" or "k: No path found" for each departure phase k,
+// and the printed cost must match too. --matrix answers are the csv of
+// costs from phase 0, an empty cell where there is no path.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "graph.h"
+#include "search.h"
+#include "query.h"
+#include "snapshot.h"
+#include "parse.h"
+#include "reach.h"
+#include "update.h"
+
+#define HOT_SOURCES 4
+#define MAX_REPORTS 10
+#define MATRIX_SIDE 16
+
+static uint64_t rng_state;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ull;
+}
+
+static int random_below(int n) {
+    return (int)(next_random() % (uint64_t)n);
+}
+
+static void write_weights(const Graph *graph) {
+    int low = graph->min_weight > 1 ? graph->min_weight : 1;
+    int high = graph->max_weight > low ? graph->max_weight : low;
+    for (int p = 0; p < graph->N; p++) printf(" %d", low + random_below(high - low + 1));
+}
+
+// Queries, with one to three updates before each when updates is set.
+// Updates and deletes name edges of the loaded graph that are still
+// there; a deleted pair drawn again is inserted instead.
+static int write_stream(const Graph *graph, size_t count, bool updates) {
+    bool *deleted = calloc(graph->E ? graph->E : 1, sizeof(bool));
+    if (!deleted) {
+        fprintf(stderr, "Out of memory writing the stream\n");
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        for (int u = updates ? 1 + random_below(3) : 0; u > 0 && graph->E > 0; u--) {
+            int64_t e = (int64_t)(next_random() % (uint64_t)graph->E);
+            int src = 0;
+            while (graph->offsets[src + 1] <= e) src++;
+            int dest = graph->targets[e];
+            int kind = random_below(4);
+            if (kind == 0) {
+                src = random_below(graph->V);
+                dest = random_below(graph->V);
+            } else if (deleted[e]) {
+                kind = 0;
+            }
+            if (kind == 3) {
+                for (int64_t k = graph->offsets[src]; k < graph->offsets[src + 1]; k++) {
+                    if (graph->targets[k] == dest) deleted[k] = true;
+                }
+                printf("D %d %d\n", src, dest);
+                continue;
+            }
+            printf("%c %d %d", kind == 0 ? 'I' : 'U', src, dest);
+            write_weights(graph);
+            putchar('\n');
+        }
+        if (updates && i % 2 == 0) {
+            printf("%d %d 0\n", random_below(graph->V < HOT_SOURCES ? graph->V : HOT_SOURCES),
+                   random_below(graph->V));
+        } else {
+            printf("%d %d %d\n", random_below(graph->V), random_below(graph->V), random_below(graph->N));
+        }
+    }
+    free(deleted);
+    return 0;
+}
+
+static void write_matrix_stream(const Graph *graph) {
+    for (int line = 0; line < 2; line++) {
+        for (int i = 0; i < MATRIX_SIDE; i++) printf(i ? " %d" : "%d", random_below(graph->V));
+        putchar('\n');
+    }
+}
+
+// Cost of walking path from phase over the cheapest parallel edge of each
+// hop, or -1 when some hop has no edge
+static long long path_cost(const Graph *graph, int phase, const int *path, int len) {
+    long long cost = 0;
+    for (int i = 1; i < len; i++) {
+        int u = path[i - 1];
+        long long hop = -1;
+        for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            if (graph->targets[e] != path[i]) continue;
+            int weight = graph->weights[(size_t)phase * graph->E + e];
+            if (hop < 0 || weight < hop) hop = weight;
+        }
+        if (hop < 0) return -1;
+        cost += hop;
+        phase = (phase + 1) % graph->N;
+    }
+    return cost;
+}
+
+// Parse an answer line into path; returns its length, 0 for "No path
+// found" and -1 when the line is neither
+static int parse_answer(const char *line, int V, int **path, int *capacity) {
+    if (strncmp(line, "No path found", 13) == 0) return 0;
+    int len = 0;
+    const char *at = line;
+    for (;;) {
+        char *end;
+        long v = strtol(at, &end, 10);
+        if (end == at) break;
+        if (v < 0 || v >= V) return -1;
+        if (len == *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 64;
+            int *grown = realloc(*path, *capacity * sizeof(int));
+            if (!grown) return -1;
+            *path = grown;
+        }
+        (*path)[len++] = (int)v;
+        at = end;
+    }
+    return len > 0 ? len : -1;
+}
+
+// Buffers and tallies shared by every answer of one check
+typedef struct Checker {
+    const char *answers_path;
+    FILE *answers;
+    char *line;
+    size_t line_capacity;
+    int *path;
+    int path_capacity;
+    size_t checked;
+    size_t wrong;
+} Checker;
+
+static void report(Checker *checker, const char *problem, int start, int end, int phase,
+                   long long got, long long expected) {
+    checker->checked++;
+    if (!problem) return;
+    if (checker->wrong < MAX_REPORTS) {
+        fprintf(stderr, "%s: answer %zu (%d %d %d): %s, cost %lld where dijkstra() has %lld\n",
+                checker->answers_path, checker->checked, start, end, phase, problem, got, expected);
+    }
+    checker->wrong++;
+}
+
+// Check text, a path or "No path found", against the cost expected from
+// phase, -1 when there is no path; NULL when it matches
+static const char *check_path(Checker *checker, const Graph *graph, int start, int end, int phase,
+                              long long expected, const char *text, long long *got) {
+    *got = -1;
+    int len = parse_answer(text, graph->V, &checker->path, &checker->path_capacity);
+    if (len < 0) return "unreadable answer";
+    if ((len == 0) != (expected < 0)) return len == 0 ? "no path, but there is one" : "a path, but there is none";
+    if (len == 0) return NULL;
+    const int *path = checker->path;
+    *got = path_cost(graph, phase, path, len);
+    if (path[0] != start || path[len - 1] != end) return "wrong endpoints";
+    if (*got < 0) return "a hop without an edge";
+    if (*got != expected) return "wrong cost";
+    return NULL;
+}
+
+// Cost of dijkstra()'s path for query departing in phase, -1 without one
+static long long expected_cost(Workspace *ws, GraphVersion *current, Query *query, int phase) {
+    acquire_version(current);
+    query->version = current;
+    query->phase = phase;
+    answer_query(ws, query);
+    long long expected = query->path ? path_cost(&current->graph, phase, query->path, query->path_len) : -1;
+    release_answers(query, 1);
+    return expected;
+}
+
+// One --profile line per departure phase, "k cost: path" or
+// "k: No path found"
+static void check_profile(Checker *checker, Workspace *ws, GraphVersion *current, Query *query) {
+    int start = query->start;
+    int end = query->end;
+    for (int k = 0; k < current->graph.N; k++) {
+        long long expected = expected_cost(ws, current, query, k);
+        long long got = -1;
+        const char *problem = NULL;
+        if (getline(&checker->line, &checker->line_capacity, checker->answers) < 0) {
+            problem = "missing answer";
+        } else {
+            char *at;
+            long phase = strtol(checker->line, &at, 10);
+            long long printed = -1;
+            if (*at == ' ') printed = strtoll(at, &at, 10);
+            if (at == checker->line || phase != k || *at != ':') {
+                problem = "unreadable answer";
+            } else {
+                while (*++at == ' ') {}
+                problem = check_path(checker, &current->graph, start, end, k, expected, at, &got);
+                if (!problem && got != printed) {
+                    problem = "printed cost differs from the path's";
+                    got = printed;
+                }
+            }
+        }
+        report(checker, problem, start, end, k, got, expected);
+    }
+}
+
+static int check_stream(Checker *checker, FILE *stream, GraphVersion **current, Workspace *ws,
+                        bool profile) {
+    const Graph *graph = &(*current)->graph;
+    CommandReader reader = {0};
+    reader.in = stream;
+    reader.V = graph->V;
+    reader.N = graph->N;
+    int status = 0;
+    Command command;
+    Query query;
+    Update update;
+    while ((command = read_command(&reader, &query, &update)) != COMMAND_END) {
+        if (command == COMMAND_UPDATE) {
+            GraphVersion *next = apply_updates(*current, &update, 1, SIZE_MAX);
+            free_updates(&update, 1);
+            if (!next) {
+                status = -1;
+                break;
+            }
+            release_version(*current);
+            *current = next;
+            continue;
+        }
+        if (profile) {
+            check_profile(checker, ws, *current, &query);
+            continue;
+        }
+        int phase = query.phase;
+        long long expected = expected_cost(ws, *current, &query, phase);
+        long long got = -1;
+        const char *problem = "missing answer";
+        if (getline(&checker->line, &checker->line_capacity, checker->answers) >= 0) {
+            problem = check_path(checker, &(*current)->graph, query.start, query.end, phase, expected,
+                                 checker->line, &got);
+        }
+        report(checker, problem, query.start, query.end, phase, got, expected);
+    }
+    free(reader.line);
+    return status;
+}
+
+// Read a line of vertex ids from in, at most MATRIX_SIDE of them
+static int read_ids(FILE *in, char **line, size_t *capacity, int V, int *ids) {
+    if (getline(line, capacity, in) < 0) return -1;
+    int count = 0;
+    char *at = *line;
+    for (;;) {
+        char *end;
+        long v = strtol(at, &end, 10);
+        if (end == at) break;
+        if (v < 0 || v >= V || count == MATRIX_SIDE) return -1;
+        ids[count++] = (int)v;
+        at = end;
+    }
+    return count;
+}
+
+// The csv --matrix writes: a header row of targets, then per source its
+// costs from phase 0
+static int check_matrix(Checker *checker, FILE *stream, GraphVersion *current, Workspace *ws) {
+    const Graph *graph = &current->graph;
+    int sources[MATRIX_SIDE];
+    int targets[MATRIX_SIDE];
+    int rows = read_ids(stream, &checker->line, &checker->line_capacity, graph->V, sources);
+    int cols = rows < 0 ? -1 : read_ids(stream, &checker->line, &checker->line_capacity, graph->V, targets);
+    if (cols < 0) {
+        fprintf(stderr, "Unreadable matrix stream\n");
+        return -1;
+    }
+
+    for (int i = -1; i < rows; i++) {
+        if (getline(&checker->line, &checker->line_capacity, checker->answers) < 0) {
+            report(checker, "missing row", i < 0 ? -1 : sources[i], -1, 0, -1, -1);
+            return 0;
+        }
+        char *at = checker->line;
+        long head = i < 0 ? -1 : strtol(at, &at, 10);
+        if (i >= 0 && head != sources[i]) {
+            report(checker, "wrong source", sources[i], -1, 0, head, sources[i]);
+            continue;
+        }
+        for (int j = 0; j < cols; j++) {
+            const char *problem = NULL;
+            long long got = -1;
+            long long expected = -1;
+            if (*at != ',') {
+                problem = "missing cell";
+            } else {
+                char *end;
+                got = strtoll(++at, &end, 10);
+                if (end == at) got = -1;
+                at = end;
+                if (i < 0) {
+                    expected = targets[j];
+                    if (got != expected) problem = "wrong target";
+                } else {
+                    Query query = {.start = sources[i], .end = targets[j]};
+                    expected = expected_cost(ws, current, &query, 0);
+                    if (got != expected) problem = got < 0 || expected < 0 ? "wrong reachability" : "wrong cost";
+                }
+            }
+            report(checker, problem, i < 0 ? -1 : sources[i], targets[j], 0, got, expected);
+        }
+    }
+    return 0;
+}
+
+static int check_answers(Graph *graph, const char *stream_path, const char *answers_path,
+                         bool profile, bool matrix) {
+    FILE *stream = fopen(stream_path, "r");
+    FILE *answers = fopen(answers_path, "r");
+    if (!stream || !answers) {
+        perror(!stream ? stream_path : answers_path);
+        if (stream) fclose(stream);
+        if (answers) fclose(answers);
+        return -1;
+    }
+
+    // Heap keys stay valid whatever weights the updates bring
+    SearchConfig config = {0};
+    config.engine = ENGINE_HEAP;
+    config.kernel = select_kernel(KERNEL_AUTO);
+    Reachability *reach = build_reachability(graph, SIZE_MAX);
+    GraphVersion *current = reach ? initial_version(graph, reach) : NULL;
+    Workspace *ws = current ? create_workspace(graph, &config) : NULL;
+    if (!ws) {
+        fprintf(stderr, "Out of memory setting up the check\n");
+        return -1;
+    }
+
+    Checker checker = {0};
+    checker.answers_path = answers_path;
+    checker.answers = answers;
+    int status = matrix ? check_matrix(&checker, stream, current, ws)
+                        : check_stream(&checker, stream, &current, ws, profile);
+    if (status == 0 && getline(&checker.line, &checker.line_capacity, answers) >= 0) {
+        fprintf(stderr, "%s: more answers than queries\n", answers_path);
+        checker.wrong++;
+    }
+    if (status == 0) {
+        fprintf(stderr, "%s: %zu answers checked, %zu wrong\n", answers_path, checker.checked, checker.wrong);
+        if (checker.wrong) status = -1;
+    }
+
+    free(checker.line);
+    free(checker.path);
+    free_workspace(ws);
+    release_version(current);
+    free_reachability(reach);
+    fclose(stream);
+    fclose(answers);
+    return status;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s --write [--queries Q] [--updates | --matrix] [--seed S] <graph>\n"
+                    "       %s [--profile | --matrix] <graph> <stream> <answers>\n", prog, prog);
+}
+
+int main(int argc, char **argv) {
+    bool write = false;
+    bool updates = false;
+    bool profile = false;
+    bool matrix = false;
+    size_t count = 300;
+    uint64_t seed = 1;
+
+    static const struct option long_options[] = {
+        {"write", no_argument, NULL, 'w'},
+        {"queries", required_argument, NULL, 'q'},
+        {"updates", no_argument, NULL, 'u'},
+        {"seed", required_argument, NULL, 's'},
+        {"profile", no_argument, NULL, 'p'},
+        {"matrix", no_argument, NULL, 'x'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "wq:us:px", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'w': write = true; break;
+        case 'q': count = strtoull(optarg, NULL, 10); break;
+        case 'u': updates = true; break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        case 'p': profile = true; break;
+        case 'x': matrix = true; break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - (write ? 1 : 3) || (profile && (write || matrix)) || (matrix && updates)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    rng_state = seed * 0x9E3779B97F4A7C15ull + 1;
+
+    const char *path = argv[optind];
+    Graph *graph = NULL;
+    if (is_snapshot(path)) {
+        graph = load_snapshot(path, true);
+    } else {
+        TextGraph *text = open_text_graph(path);
+        if (!text) return EXIT_FAILURE;
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        graph = parse_text_graph(text, cpus > 0 ? (int)cpus : 1);
+        close_text_graph(text);
+    }
+    if (!graph) return EXIT_FAILURE;
+
+    int status = 0;
+    if (write && matrix) {
+        write_matrix_stream(graph);
+    } else if (write) {
+        status = write_stream(graph, count, updates);
+    } else {
+        status = check_answers(graph, argv[optind + 1], argv[optind + 2], profile, matrix);
+    }
+    free_graph(graph);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,128 @@
+// Synthetic periodic graphs in graph.txt format, written to stdout
+//
+//   generate --kind random|grid [--vertices V] [--degree D] [--period N]
+//            [--weights MIN:MAX] [--oneway P] [--seed S]
+//
+// random: every vertex gets 1 .. 2D - 1 out-edges to uniform targets, so
+// the average out-degree is D. grid: the largest square grid with at most
+// V vertices and 4-neighbour streets; each street is one-way with
+// probability P and two-way otherwise, which leaves unreachable pairs.
+// Every edge draws an independent weight per phase from MIN .. MAX.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+
+static uint64_t rng_state;
+
+// xorshift64*: fast and reproducible across platforms for a given seed
+static uint64_t next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ull;
+}
+
+static int uniform(int lo, int hi) {
+    return lo + (int)(next_random() % (uint64_t)(hi - lo + 1));
+}
+
+static void write_edge(int u, int v, int N, int min_weight, int max_weight) {
+    printf("%d %d", u, v);
+    for (int p = 0; p < N; p++) printf(" %d", uniform(min_weight, max_weight));
+    putchar('\n');
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s --kind random|grid [--vertices V] [--degree D] [--period N]\n"
+                    "       [--weights MIN:MAX] [--oneway P] [--seed S]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *kind = NULL;
+    int V = 100000;
+    int degree = 4;
+    int N = 8;
+    int min_weight = 1;
+    int max_weight = 100;
+    double oneway = 0.0;
+    uint64_t seed = 1;
+
+    static const struct option long_options[] = {
+        {"kind", required_argument, NULL, 'k'},
+        {"vertices", required_argument, NULL, 'V'},
+        {"degree", required_argument, NULL, 'd'},
+        {"period", required_argument, NULL, 'N'},
+        {"weights", required_argument, NULL, 'w'},
+        {"oneway", required_argument, NULL, 'o'},
+        {"seed", required_argument, NULL, 's'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "k:V:d:N:w:o:s:", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'k': kind = optarg; break;
+        case 'V': V = atoi(optarg); break;
+        case 'd': degree = atoi(optarg); break;
+        case 'N': N = atoi(optarg); break;
+        case 'w':
+            if (sscanf(optarg, "%d:%d", &min_weight, &max_weight) != 2) {
+                fprintf(stderr, "Invalid weight range: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o': oneway = atof(optarg); break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!kind || V < 2 || degree < 1 || N < 1 || min_weight > max_weight || oneway < 0 || oneway > 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    // A zero state would stay zero forever
+    rng_state = seed * 0x9E3779B97F4A7C15ull + 1;
+
+    if (strcmp(kind, "random") == 0) {
+        printf("%d %d\n", V, N);
+        for (int u = 0; u < V; u++) {
+            int out = uniform(1, 2 * degree - 1);
+            for (int i = 0; i < out; i++) {
+                int v = uniform(0, V - 2);
+                write_edge(u, v >= u ? v + 1 : v, N, min_weight, max_weight);
+            }
+        }
+    } else if (strcmp(kind, "grid") == 0) {
+        int side = 1;
+        while ((int64_t)(side + 1) * (side + 1) <= V) side++;
+        printf("%d %d\n", side * side, N);
+        uint64_t threshold = (uint64_t)(oneway * 1000000);
+        for (int r = 0; r < side; r++) {
+            for (int c = 0; c < side; c++) {
+                int u = r * side + c;
+                int neighbors[2] = {c + 1 < side ? u + 1 : -1, r + 1 < side ? u + side : -1};
+                for (int k = 0; k < 2; k++) {
+                    int v = neighbors[k];
+                    if (v < 0) continue;
+                    if (next_random() % 1000000 < threshold) {
+                        // One-way street in a random direction
+                        if (next_random() & 1) write_edge(u, v, N, min_weight, max_weight);
+                        else write_edge(v, u, N, min_weight, max_weight);
+                    } else {
+                        write_edge(u, v, N, min_weight, max_weight);
+                        write_edge(v, u, N, min_weight, max_weight);
+                    }
+                }
+            }
+        }
+    } else {
+        fprintf(stderr, "Unknown graph kind: %s\n", kind);
+        return EXIT_FAILURE;
+    }
+    return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
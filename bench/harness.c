@@ -0,0 +1,232 @@
+// Replay a synthetic query workload against one graph and report
+// throughput and latency percentiles as one JSON object per line
+//
+//   harness [--workload uniform|local|unreachable] [--queries Q] [--seed S]
+//           [--engine NAME] [--kernel NAME] [--raw] <graph>
+//
+// uniform: start and end drawn uniformly. local: end is where a random
+// walk of up to LOCAL_HOPS edges from start stops. unreachable: nine in
+// ten pairs have no path, the rest are uniform. Every query goes through
+// answer_query() on a single workspace, which is dijkstra() for the
+// default options; --raw leaves out the reachability filter so that
+// unreachable pairs pay for a full search.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "graph.h"
+#include "queue.h"
+#include "search.h"
+#include "query.h"
+#include "snapshot.h"
+#include "parse.h"
+#include "reach.h"
+
+#define LOCAL_HOPS 16
+#define UNREACHABLE_TRIES 1000
+
+static uint64_t rng_state;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ull;
+}
+
+static int random_vertex(int V) {
+    return (int)(next_random() % (uint64_t)V);
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : (x > y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, size_t count, double p) {
+    size_t rank = (size_t)(p / 100.0 * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+static int local_end(const Graph *graph, int start) {
+    int at = start;
+    int hops = 1 + random_vertex(LOCAL_HOPS);
+    for (int h = 0; h < hops; h++) {
+        int64_t degree = graph->offsets[at + 1] - graph->offsets[at];
+        if (degree == 0) break;
+        at = graph->targets[graph->offsets[at] + (int64_t)(next_random() % (uint64_t)degree)];
+    }
+    return at;
+}
+
+// Returns how many of the pairs have no path
+static size_t make_workload(const Graph *graph, const Reachability *reach, const char *workload,
+                            Query *queries, size_t count) {
+    int V = graph->V;
+    size_t unreachable = 0;
+    ReachScratch scratch = {0};
+    for (size_t i = 0; i < count; i++) {
+        Query *query = &queries[i];
+        query->start = random_vertex(V);
+        query->end = random_vertex(V);
+        if (strcmp(workload, "local") == 0) {
+            query->end = local_end(graph, query->start);
+        } else if (strcmp(workload, "unreachable") == 0 && next_random() % 10 != 0) {
+            for (int t = 0; t < UNREACHABLE_TRIES && reaches(reach, &scratch, query->start, query->end); t++) {
+                query->start = random_vertex(V);
+                query->end = random_vertex(V);
+            }
+        }
+        query->phase = 0;
+        query->path = NULL;
+        query->path_len = 0;
+        query->version = NULL;
+        query->profile = NULL;
+        if (!reaches(reach, &scratch, query->start, query->end)) unreachable++;
+    }
+    free_reach_scratch(&scratch);
+    return unreachable;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--workload uniform|local|unreachable] [--queries Q] [--seed S]\n"
+                    "       [--engine NAME] [--kernel NAME] [--raw] <graph>\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *workload = "uniform";
+    size_t count = 1000;
+    uint64_t seed = 1;
+    Engine engine = ENGINE_AUTO;
+    Kernel kernel = KERNEL_AUTO;
+    bool raw = false;
+
+    static const struct option long_options[] = {
+        {"workload", required_argument, NULL, 'w'},
+        {"queries", required_argument, NULL, 'q'},
+        {"seed", required_argument, NULL, 's'},
+        {"engine", required_argument, NULL, 'e'},
+        {"kernel", required_argument, NULL, 'k'},
+        {"raw", no_argument, NULL, 'r'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "w:q:s:e:k:r", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'w': workload = optarg; break;
+        case 'q': count = strtoull(optarg, NULL, 10); break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        case 'e':
+            if (strcmp(optarg, "heap") == 0) engine = ENGINE_HEAP;
+            else if (strcmp(optarg, "dial") == 0) engine = ENGINE_DIAL;
+            else if (strcmp(optarg, "radix") == 0) engine = ENGINE_RADIX;
+            else if (strcmp(optarg, "auto") != 0) {
+                fprintf(stderr, "Unknown engine: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'k':
+            if (strcmp(optarg, "scalar") == 0) kernel = KERNEL_SCALAR;
+            else if (strcmp(optarg, "sse4") == 0) kernel = KERNEL_SSE4;
+            else if (strcmp(optarg, "avx2") == 0) kernel = KERNEL_AVX2;
+            else if (strcmp(optarg, "auto") != 0) {
+                fprintf(stderr, "Unknown kernel: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'r': raw = true; break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1 || count == 0 ||
+        (strcmp(workload, "uniform") != 0 && strcmp(workload, "local") != 0 &&
+         strcmp(workload, "unreachable") != 0)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    rng_state = seed * 0x9E3779B97F4A7C15ull + 1;
+
+    const char *path = argv[optind];
+    double began = seconds();
+    Graph *graph = NULL;
+    if (is_snapshot(path)) {
+        graph = load_snapshot(path, false);
+    } else {
+        TextGraph *text = open_text_graph(path);
+        if (!text) return EXIT_FAILURE;
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        graph = parse_text_graph(text, cpus > 0 ? (int)cpus : 1);
+        close_text_graph(text);
+    }
+    if (!graph) return EXIT_FAILURE;
+    double loaded = seconds();
+
+    SearchConfig config = {0};
+    config.engine = select_engine(engine, graph->min_weight, graph->max_weight);
+    config.kernel = select_kernel(kernel);
+    Reachability *reach = build_reachability(graph, SIZE_MAX);
+    Query *queries = malloc(count * sizeof(Query));
+    double *latency = malloc(count * sizeof(double));
+    if (!reach || !queries || !latency) {
+        fprintf(stderr, "Out of memory setting up the workload\n");
+        return EXIT_FAILURE;
+    }
+    if (!raw) config.reach = reach;
+    Workspace *ws = create_workspace(graph, &config);
+    if (!ws) {
+        fprintf(stderr, "Out of memory allocating search workspace\n");
+        return EXIT_FAILURE;
+    }
+    size_t unreachable = make_workload(graph, reach, workload, queries, count);
+
+    size_t found = 0;
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+        double t0 = seconds();
+        answer_query(ws, &queries[i]);
+        latency[i] = seconds() - t0;
+        total += latency[i];
+        if (queries[i].path) found++;
+        release_answers(&queries[i], 1);
+    }
+    qsort(latency, count, sizeof(double), compare_doubles);
+
+    struct rusage usage_info;
+    getrusage(RUSAGE_SELF, &usage_info);
+    printf("{\"graph\": \"%s\", \"V\": %d, \"E\": %lld, \"N\": %d, \"engine\": \"%s\", "
+           "\"kernel\": \"%s\", \"workload\": \"%s\", \"reach_filter\": %s, \"queries\": %zu, "
+           "\"unreachable\": %zu, \"found\": %zu, \"load_s\": %.3f, \"total_s\": %.6f, "
+           "\"qps\": %.1f, \"p50_us\": %.1f, \"p95_us\": %.1f, \"p99_us\": %.1f, "
+           "\"max_us\": %.1f, \"peak_rss_kb\": %ld}\n",
+           path, graph->V, (long long)graph->E, graph->N, engine_name(config.engine),
+           kernel_name(config.kernel), workload, raw ? "false" : "true", count,
+           unreachable, found, loaded - began, total, count / total,
+           percentile(latency, count, 50) * 1e6, percentile(latency, count, 95) * 1e6,
+           percentile(latency, count, 99) * 1e6, latency[count - 1] * 1e6,
+           usage_info.ru_maxrss);
+
+    free_workspace(ws);
+    free_reachability(reach);
+    free(queries);
+    free(latency);
+    free_graph(graph);
+    return EXIT_SUCCESS;
+}
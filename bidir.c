@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bidir.h"
+
+// Forward relaxation of the settled state (u, step)
+static void relax_forward(Workspace *ws, int u, int step, int cost, int *best, size_t *meet) {
+    const Graph *graph = ws->graph;
+    int N = graph->N;
+    uint32_t labelled = ws->gen;
+    int next_step = (step + 1) % N;
+    const int *weights = graph->weights + (size_t)step * graph->E;
+    STAT_ADD(ws->stats, relaxations, graph->offsets[u + 1] - graph->offsets[u]);
+
+    for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+        int v = graph->targets[e];
+        int new_cost = cost + weights[e];
+        size_t t = (size_t)v * N + next_step;
+        if (ws->stamp[t] < labelled || (ws->stamp[t] == labelled && new_cost < ws->dist[t])) {
+            ws->dist[t] = new_cost;
+            ws->prev[t] = u;
+            ws->stamp[t] = labelled;
+            STAT_ADD(ws->stats, improvements, 1);
+            STAT_ADD(ws->stats, pushes, 1);
+            if (queue_push(ws->queue, t, new_cost) != 0) {
+                fprintf(stderr, "Out of memory growing queue\n");
+                exit(EXIT_FAILURE);
+            }
+            if (ws->bstamp[t] >= labelled && new_cost + ws->bdist[t] < *best) {
+                *best = new_cost + ws->bdist[t];
+                *meet = t;
+            }
+        }
+    }
+}
+
+// Backward relaxation of the settled state (v, step): every in-edge u -> v
+// taken in phase step - 1 leads back to state (u, step - 1)
+static void relax_backward(Workspace *ws, int v, int step, int cost, int *best, size_t *meet) {
+    const Graph *graph = ws->graph;
+    int N = graph->N;
+    uint32_t labelled = ws->gen;
+    int prev_step = (step - 1 + N) % N;
+    const int *weights = graph->rev_weights + (size_t)prev_step * graph->E;
+    STAT_ADD(ws->stats, relaxations, graph->rev_offsets[v + 1] - graph->rev_offsets[v]);
+
+    for (int64_t r = graph->rev_offsets[v]; r < graph->rev_offsets[v + 1]; r++) {
+        int u = graph->rev_sources[r];
+        int new_cost = cost + weights[r];
+        size_t t = (size_t)u * N + prev_step;
+        if (ws->bstamp[t] < labelled || (ws->bstamp[t] == labelled && new_cost < ws->bdist[t])) {
+            ws->bdist[t] = new_cost;
+            ws->bnext[t] = v;
+            ws->bstamp[t] = labelled;
+            STAT_ADD(ws->stats, improvements, 1);
+            STAT_ADD(ws->stats, pushes, 1);
+            if (queue_push(ws->bqueue, t, new_cost) != 0) {
+                fprintf(stderr, "Out of memory growing queue\n");
+                exit(EXIT_FAILURE);
+            }
+            if (ws->stamp[t] >= labelled && new_cost + ws->dist[t] < *best) {
+                *best = new_cost + ws->dist[t];
+                *meet = t;
+            }
+        }
+    }
+}
+
+// Join the forward chain into the meeting state with the backward chain
+// out of it
+static int *join_path(Workspace *ws, size_t meet, int *path_len) {
+    int N = ws->graph->N;
+    int meet_vertex = meet / N;
+    int meet_step = meet % N;
+
+    int head = 0;
+    for (int at = meet_vertex, step = meet_step; at != -1; step = (step - 1 + N) % N) {
+        head++;
+        at = ws->prev[(size_t)at * N + step];
+    }
+    int tail = 0;
+    for (int at = meet_vertex, step = meet_step; ; step = (step + 1) % N) {
+        int next = ws->bnext[(size_t)at * N + step];
+        if (next == -1) break;
+        tail++;
+        at = next;
+    }
+
+    int *path = malloc((head + tail) * sizeof(int));
+    if (!path) return NULL;
+    int i = head;
+    for (int at = meet_vertex, step = meet_step; at != -1; step = (step - 1 + N) % N) {
+        path[--i] = at;
+        at = ws->prev[(size_t)at * N + step];
+    }
+    i = head;
+    for (int at = meet_vertex, step = meet_step; ; step = (step + 1) % N) {
+        int next = ws->bnext[(size_t)at * N + step];
+        if (next == -1) break;
+        path[i++] = next;
+        at = next;
+    }
+    *path_len = head + tail;
+    return path;
+}
+
+// Bidirectional Dijkstra over (vertex, phase) states. The forward search
+// starts at (start, phase); the arrival phase is unknown, so the backward
+// search on the reversed graph starts from every (end, p) at cost 0.
+// best tracks the cheapest forward + backward label seen on one state.
+// Keys pop in non-decreasing order on each side, so once the last popped
+// forward and backward keys add up to at least best, no unsettled state can
+// lie on a cheaper path and the meeting state is optimal.
+int *bidir_search(Workspace *ws, int start, int phase, int end, int *path_len) {
+    int N = ws->graph->N;
+    begin_search(ws);
+    uint32_t labelled = ws->gen;
+    uint32_t settled = ws->gen + 1;
+
+    int best = INF;
+    size_t meet = 0;
+
+    size_t origin = (size_t)start * N + phase;
+    ws->dist[origin] = 0;
+    ws->prev[origin] = -1;
+    ws->stamp[origin] = labelled;
+    queue_push(ws->queue, origin, 0);
+
+    for (int p = 0; p < N; p++) {
+        size_t s = (size_t)end * N + p;
+        ws->bdist[s] = 0;
+        ws->bnext[s] = -1;
+        ws->bstamp[s] = labelled;
+        queue_push(ws->bqueue, s, 0);
+    }
+    STAT_ADD(ws->stats, pushes, 1 + N);
+    if (start == end) {
+        best = 0;
+        meet = origin;
+    }
+
+    int forward_key = 0;
+    int backward_key = 0;
+    HeapEntry current;
+    while (best == INF || (long long)forward_key + backward_key < best) {
+        STAT_MAX(ws->stats, max_queue, queue_size(ws->queue) + queue_size(ws->bqueue));
+        // Advance the side whose frontier is closer
+        if (forward_key <= backward_key) {
+            if (!pop_state(ws->queue, &current)) break;
+            STAT_ADD(ws->stats, pops, 1);
+            forward_key = current.key;
+            size_t s = current.state;
+            if (ws->stamp[s] == settled) {
+                STAT_ADD(ws->stats, stale_pops, 1);
+                continue;
+            }
+            ws->stamp[s] = settled;
+            STAT_ADD(ws->stats, settled, 1);
+            relax_forward(ws, s / N, s % N, ws->dist[s], &best, &meet);
+        } else {
+            if (!pop_state(ws->bqueue, &current)) break;
+            STAT_ADD(ws->stats, pops, 1);
+            backward_key = current.key;
+            size_t s = current.state;
+            if (ws->bstamp[s] == settled) {
+                STAT_ADD(ws->stats, stale_pops, 1);
+                continue;
+            }
+            ws->bstamp[s] = settled;
+            STAT_ADD(ws->stats, settled, 1);
+            relax_backward(ws, s / N, s % N, ws->bdist[s], &best, &meet);
+        }
+    }
+
+    *path_len = 0;
+    if (best == INF) return NULL;
+    return join_path(ws, meet, path_len);
+}
@@ -0,0 +1,8 @@
+#ifndef BIDIR_H
+#define BIDIR_H
+
+#include "search.h"
+
+int *bidir_search(Workspace *ws, int start, int phase, int end, int *path_len);
+
+#endif // BIDIR_H
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+SearchCache *create_search_cache(int V, size_t cap) {
+    SearchCache *cache = calloc(1, sizeof(SearchCache));
+    if (!cache) return NULL;
+    cache->by_source = calloc(V, sizeof(CachedSearch *));
+    if (!cache->by_source) {
+        free(cache);
+        return NULL;
+    }
+    cache->cap = cap;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+static void free_entry(CachedSearch *entry) {
+    free(entry->states);
+    free(entry->dist);
+    free(entry->prev);
+    free(entry->settled);
+    free(entry->index);
+    pthread_mutex_destroy(&entry->lock);
+    free(entry);
+}
+
+static inline size_t index_slot(uint32_t state, size_t mask) {
+    return ((size_t)state * 2654435761u) & mask;
+}
+
+// Position of state in entry, or -1 if the search never labelled it
+static int64_t find_state(const CachedSearch *entry, uint32_t state) {
+    if (entry->count == 0) return -1;
+    for (size_t slot = index_slot(state, entry->index_mask);; slot = (slot + 1) & entry->index_mask) {
+        uint32_t at = entry->index[slot];
+        if (at == 0) return -1;
+        if (entry->states[at - 1] == state) return at - 1;
+    }
+}
+
+// Replace entry's labels with those of the search in ws. Returns -1, with
+// the entry emptied, when memory runs out.
+static int save_search(CachedSearch *entry, const Workspace *ws) {
+    size_t count = ws->ntouched;
+    size_t slots = 16;
+    while (slots < 2 * count) slots *= 2;
+    uint32_t *states = realloc(entry->states, count * sizeof(uint32_t));
+    int *dist = realloc(entry->dist, count * sizeof(int));
+    int *prev = realloc(entry->prev, count * sizeof(int));
+    uint8_t *settled = realloc(entry->settled, count * sizeof(uint8_t));
+    if (states) entry->states = states;
+    if (dist) entry->dist = dist;
+    if (prev) entry->prev = prev;
+    if (settled) entry->settled = settled;
+    free(entry->index);
+    entry->index = calloc(slots, sizeof(uint32_t));
+    if (!states || !dist || !prev || !settled || !entry->index) {
+        entry->count = 0;
+        entry->bytes = sizeof(CachedSearch);
+        return -1;
+    }
+
+    entry->count = count;
+    entry->index_mask = slots - 1;
+    entry->unexpanded = ws->unexpanded;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t s = ws->touched[i];
+        states[i] = s;
+        dist[i] = ws->dist[s];
+        prev[i] = ws->prev[s];
+        settled[i] = is_settled(ws, s);
+        size_t slot = index_slot(s, entry->index_mask);
+        while (entry->index[slot]) slot = (slot + 1) & entry->index_mask;
+        entry->index[slot] = i + 1;
+    }
+    entry->bytes = sizeof(CachedSearch) + count * (2 * sizeof(int) + sizeof(uint32_t) + sizeof(uint8_t)) +
+                   slots * sizeof(uint32_t);
+    return 0;
+}
+
+// Load entry's labels into ws as its current search and queue the
+// frontier again, so continue_search() picks up where it stopped
+static void restore_search(Workspace *ws, const CachedSearch *entry) {
+    begin_search(ws);
+    uint32_t labelled = ws->gen;
+    uint32_t settled = ws->gen + 1;
+    size_t lowest = entry->count;
+    ws->ntouched = 0;
+    for (size_t i = 0; i < entry->count; i++) {
+        uint32_t s = entry->states[i];
+        ws->dist[s] = entry->dist[i];
+        ws->prev[s] = entry->prev[i];
+        ws->touched[ws->ntouched++] = s;
+        bool final = entry->settled[i] && s != entry->unexpanded;
+        ws->stamp[s] = final ? settled : labelled;
+        if (!final && (lowest == entry->count || entry->dist[i] < entry->dist[lowest])) lowest = i;
+    }
+    // Dial's queue starts scanning at the first key pushed
+    if (lowest == entry->count) return;
+    queue_push(ws->queue, entry->states[lowest], entry->dist[lowest]);
+    for (size_t i = 0; i < entry->count; i++) {
+        if (i != lowest && ws->stamp[entry->states[i]] == labelled) {
+            queue_push(ws->queue, entry->states[i], entry->dist[i]);
+        }
+    }
+}
+
+// Walk end's path out of the labels if some phase of end is final
+static bool cached_path(const CachedSearch *entry, int N, int end, int **path, int *path_len) {
+    int min_cost = INF;
+    int final_step = -1;
+    bool reached = false;
+    for (int p = 0; p < N; p++) {
+        int64_t i = find_state(entry, (uint32_t)((size_t)end * N + p));
+        if (i < 0) continue;
+        if (entry->settled[i]) reached = true;
+        if (entry->dist[i] < min_cost) {
+            min_cost = entry->dist[i];
+            final_step = p;
+        }
+    }
+    if (!reached) return false;
+
+    // A settled phase holds the least label of end: frontier ones are no
+    // cheaper than anything settled
+    int len = 0;
+    for (int at = end, step = final_step; at != -1; step = (step - 1 + N) % N) {
+        len++;
+        at = entry->prev[find_state(entry, (uint32_t)((size_t)at * N + step))];
+    }
+    *path = malloc(len * sizeof(int));
+    *path_len = 0;
+    if (!*path) return true;
+    *path_len = len;
+    for (int at = end, step = final_step; at != -1; step = (step - 1 + N) % N) {
+        (*path)[--len] = at;
+        at = entry->prev[find_state(entry, (uint32_t)((size_t)at * N + step))];
+    }
+    return true;
+}
+
+static void unlink_entry(SearchCache *cache, CachedSearch *entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else cache->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else cache->oldest = entry->newer;
+    entry->newer = entry->older = NULL;
+}
+
+static void push_newest(SearchCache *cache, CachedSearch *entry) {
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if (cache->newest) cache->newest->newer = entry;
+    cache->newest = entry;
+    if (!cache->oldest) cache->oldest = entry;
+}
+
+static void drop_entry(SearchCache *cache, CachedSearch *entry) {
+    unlink_entry(cache, entry);
+    cache->by_source[entry->source] = NULL;
+    cache->bytes -= entry->bytes;
+    cache->entries--;
+    free_entry(entry);
+}
+
+// Drop unpinned entries, oldest first, until the cap holds. Called with
+// the cache lock held.
+static void evict(SearchCache *cache) {
+    CachedSearch *entry = cache->oldest;
+    while (cache->bytes > cache->cap && entry) {
+        CachedSearch *newer = entry->newer;
+        if (entry->pins == 0) {
+            cache->evictions++;
+            cache->evicted_bytes += entry->bytes;
+            drop_entry(cache, entry);
+        }
+        entry = newer;
+    }
+}
+
+// Single-pair query through the cache: answer from start's suspended
+// search when it already settled end, resume it when it did not, or run
+// a new search and keep it
+int *cached_dijkstra(Workspace *ws, SearchCache *cache, int start, int end, int *path_len) {
+    int N = ws->graph->N;
+    int *path = NULL;
+    *path_len = 0;
+
+    pthread_mutex_lock(&cache->lock);
+    CachedSearch *entry = cache->by_source[start];
+    if (entry) {
+        entry->pins++;
+        unlink_entry(cache, entry);
+        push_newest(cache, entry);
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (!entry) {
+        path = dijkstra(ws, start, 0, end, path_len);
+        entry = calloc(1, sizeof(CachedSearch));
+        if (!entry) return path;
+        entry->source = start;
+        pthread_mutex_init(&entry->lock, NULL);
+        bool saved = save_search(entry, ws) == 0;
+        pthread_mutex_lock(&cache->lock);
+        cache->misses++;
+        // Another worker may have kept a search from start meanwhile
+        if (!saved || entry->bytes > cache->cap || cache->by_source[start]) {
+            if (saved && entry->bytes > cache->cap) cache->oversized++;
+            pthread_mutex_unlock(&cache->lock);
+            free_entry(entry);
+            return path;
+        }
+        cache->by_source[start] = entry;
+        push_newest(cache, entry);
+        cache->entries++;
+        cache->bytes += entry->bytes;
+        evict(cache);
+        pthread_mutex_unlock(&cache->lock);
+        return path;
+    }
+
+    pthread_mutex_lock(&entry->lock);
+    size_t before = entry->bytes;
+    bool hit = cached_path(entry, N, end, &path, path_len);
+    if (!hit) {
+        // An entry left empty by a failed save starts over
+        if (entry->count > 0) {
+            restore_search(ws, entry);
+            continue_search(ws, &end, 1);
+            path = extract_path(ws, end, path_len);
+        } else {
+            path = dijkstra(ws, start, 0, end, path_len);
+        }
+        save_search(entry, ws);
+    }
+    size_t after = entry->bytes;
+    pthread_mutex_unlock(&entry->lock);
+
+    pthread_mutex_lock(&cache->lock);
+    if (hit) cache->hits++;
+    else cache->resumes++;
+    cache->bytes += after - before;
+    entry->pins--;
+    // An entry that outgrew the cap on its own goes first, rather than
+    // pushing every other one out
+    if (after > cache->cap && entry->pins == 0) {
+        cache->oversized++;
+        drop_entry(cache, entry);
+    }
+    evict(cache);
+    pthread_mutex_unlock(&cache->lock);
+    return path;
+}
+
+void report_search_cache(const SearchCache *cache, FILE *out) {
+    fprintf(out, "search cache: %llu hits, %llu resumes, %llu misses; %llu evictions (%llu bytes), "
+                 "%llu too large; %zu searches in %zu bytes (cap %zu)\n",
+            (unsigned long long)cache->hits, (unsigned long long)cache->resumes,
+            (unsigned long long)cache->misses, (unsigned long long)cache->evictions,
+            (unsigned long long)cache->evicted_bytes, (unsigned long long)cache->oversized,
+            cache->entries, cache->bytes, cache->cap);
+}
+
+void free_search_cache(SearchCache *cache) {
+    CachedSearch *entry = cache->oldest;
+    while (entry) {
+        CachedSearch *newer = entry->newer;
+        free_entry(entry);
+        entry = newer;
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->by_source);
+    free(cache);
+}
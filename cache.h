@@ -0,0 +1,59 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "search.h"
+
+// Labels of one suspended search from phase 0 of source: every state it
+// labelled, settled or still on the frontier, with an open-addressing
+// index from state to position
+typedef struct CachedSearch {
+    int source;
+    size_t count;
+    uint32_t *states;
+    int *dist;
+    int *prev;
+    uint8_t *settled;        // 1 when final; 0 for frontier states
+    uint32_t *index;         // Position + 1 per slot, 0 when empty
+    size_t index_mask;
+    uint32_t unexpanded;     // Settled, but its edges are still to scan
+    size_t bytes;            // Charged against the cache's cap
+    int pins;                // Queries using it; pinned entries stay
+    pthread_mutex_t lock;    // Held while a query reads or resumes it
+    struct CachedSearch *newer;
+    struct CachedSearch *older;
+} CachedSearch;
+
+// Suspended searches shared by every workspace, keyed by source and
+// evicted least recently used first once their labels exceed cap bytes
+//
+// A query whose end is already settled in its source's entry is answered
+// from the labels alone. Otherwise the labels are copied back into the
+// workspace, the frontier goes back on the queue, and the search carries
+// on from where it stopped; the grown labels then replace the entry.
+typedef struct SearchCache {
+    pthread_mutex_t lock;    // Guards everything below
+    size_t cap;
+    size_t bytes;
+    size_t entries;
+    CachedSearch **by_source;    // V
+    CachedSearch *newest;
+    CachedSearch *oldest;
+
+    uint64_t hits;           // Answered from settled labels
+    uint64_t resumes;        // Answered by continuing a suspended search
+    uint64_t misses;         // Answered by a new search
+    uint64_t evictions;
+    uint64_t evicted_bytes;
+    uint64_t oversized;      // Searches too large to keep under the cap
+} SearchCache;
+
+SearchCache *create_search_cache(int V, size_t cap);
+int *cached_dijkstra(Workspace *ws, SearchCache *cache, int start, int end, int *path_len);
+void report_search_cache(const SearchCache *cache, FILE *out);
+void free_search_cache(SearchCache *cache);
+
+#endif // CACHE_H
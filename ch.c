@@ -0,0 +1,924 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "ch.h"
+#include "heap.h"
+
+// Witness search budget: pops per arc of an average remaining vertex, with
+// a floor. The remaining graph gets denser as vertices go, so the budget
+// grows with it; a missed witness only costs an extra arc.
+#define WITNESS_POPS_PER_ARC 20
+#define WITNESS_MIN_POPS 100
+
+// Contraction stops once the remaining vertices average this many arcs
+// each. Past that point every contraction adds shortcuts by the hundred,
+// so the rest is left as a core that queries search in full.
+#define CORE_ARCS_PER_VERTEX 32
+
+// Contraction state: arcs live in one growing array and every remaining
+// vertex keeps the ids of its out- and in-arcs among remaining vertices
+typedef struct Builder {
+    int V;
+    int N;
+    ChArc *arcs;
+    int *cost;
+    bool *dead;          // Dominated by a later parallel shortcut
+    int arc_count;
+    int arc_capacity;
+    int shortcut_count;
+    IntList *out;
+    IntList *in;
+    bool *contracted;
+    int *depth;          // Contracted neighbours so far, spreads the order
+    int remaining;       // Vertices not yet contracted
+    int64_t live_arcs;   // Arcs among them
+
+    // Witness search over the (vertex, phase) states of the remaining graph,
+    // with one label per departure phase: a state labelled by the current
+    // search (stamp == gen) owns the N labels at labels + slot * N
+    uint32_t *stamp;
+    int *slot;
+    int *labels;
+    int labelled;
+    int label_capacity;
+    uint32_t gen;
+    MinHeap *heap;
+
+    // Shortcut candidates out of one in-neighbour, one group per head b:
+    // group_of[b] is b's group or -1, and a group holds N residues x N phases
+    int *group_of;
+    int *group_head;
+    int *group_cost;     // Witnessed phases set to INF
+    int *group_full;     // Unpruned copy
+    int groups;
+    int group_capacity;
+
+    int *bound;          // Per departure phase: dearest candidate
+    int *loop;           // N x N loop closure of the vertex being contracted
+    int *seen;           // Per vertex: visit that last counted it
+    int visit;
+} Builder;
+
+// Forget the arcs between x and a vertex that is being contracted
+// Returns how many were dropped.
+static int drop_arcs(IntList *list, const ChArc *arcs, int x, bool outgoing) {
+    int kept = 0;
+    for (int i = 0; i < list->count; i++) {
+        const ChArc *arc = &arcs[list->items[i]];
+        if ((outgoing ? arc->to : arc->from) == x) continue;
+        list->items[kept++] = list->items[i];
+    }
+    int dropped = list->count - kept;
+    list->count = kept;
+    return dropped;
+}
+
+// Remove arc id from list
+static void unlink_arc(IntList *list, int id) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->items[i] == id) {
+            list->items[i] = list->items[--list->count];
+            return;
+        }
+    }
+}
+
+static int add_arc(Builder *b, int from, int to, int residue, int middle, const int *cost) {
+    int N = b->N;
+    if (b->arc_count == b->arc_capacity) {
+        int capacity = b->arc_capacity ? b->arc_capacity * 2 : 1024;
+        ChArc *arcs = realloc(b->arcs, capacity * sizeof(ChArc));
+        if (!arcs) return -1;
+        b->arcs = arcs;
+        int *costs = realloc(b->cost, (size_t)capacity * N * sizeof(int));
+        if (!costs) return -1;
+        b->cost = costs;
+        bool *dead = realloc(b->dead, capacity * sizeof(bool));
+        if (!dead) return -1;
+        b->dead = dead;
+        b->arc_capacity = capacity;
+    }
+    int id = b->arc_count;
+    b->arcs[id] = (ChArc){from, to, residue, middle};
+    b->dead[id] = false;
+    memcpy(b->cost + (size_t)id * N, cost, N * sizeof(int));
+    if (list_push(&b->out[from], id) != 0 || list_push(&b->in[to], id) != 0) return -1;
+    b->arc_count++;
+    b->live_arcs++;
+    return id;
+}
+
+// Cheapest way from (x, q) to (x, q') using only the loops at x, as an
+// N x N table; the arcs scanned are ids[0 .. count - 1]
+static void loop_closure(const ChArc *arcs, const int *cost, const int *ids, int64_t count,
+                         int x, int N, int *loop) {
+    for (int i = 0; i < N * N; i++) loop[i] = INF;
+    for (int q = 0; q < N; q++) loop[q * N + q] = 0;
+    for (int64_t i = 0; i < count; i++) {
+        const ChArc *arc = &arcs[ids[i]];
+        if (arc->from != x || arc->to != x) continue;
+        for (int q = 0; q < N; q++) {
+            int c = cost[(size_t)ids[i] * N + q];
+            int at = q * N + (q + arc->residue) % N;
+            if (c < loop[at]) loop[at] = c;
+        }
+    }
+    for (int k = 0; k < N; k++) {
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                int via = add_costs(loop[i * N + k], loop[k * N + j]);
+                if (via < loop[i * N + j]) loop[i * N + j] = via;
+            }
+        }
+    }
+}
+
+// Candidate group for head vertex to, created on first use
+static int *candidate_group(Builder *b, int to) {
+    int N = b->N;
+    if (b->group_of[to] < 0) {
+        if (b->groups == b->group_capacity) {
+            int capacity = b->group_capacity ? b->group_capacity * 2 : 16;
+            int *heads = realloc(b->group_head, capacity * sizeof(int));
+            if (!heads) return NULL;
+            b->group_head = heads;
+            int *costs = realloc(b->group_cost, (size_t)capacity * N * N * sizeof(int));
+            if (!costs) return NULL;
+            b->group_cost = costs;
+            costs = realloc(b->group_full, (size_t)capacity * N * N * sizeof(int));
+            if (!costs) return NULL;
+            b->group_full = costs;
+            b->group_capacity = capacity;
+        }
+        int g = b->groups++;
+        b->group_head[g] = to;
+        for (int i = 0; i < N * N; i++) b->group_cost[(size_t)g * N * N + i] = INF;
+        b->group_of[to] = g;
+    }
+    return b->group_cost + (size_t)b->group_of[to] * N * N;
+}
+
+// Labels of state s in the current witness search, INF when first touched.
+// The pointer is good until the next call that adds a state.
+static int *witness_labels(Builder *b, size_t s) {
+    int N = b->N;
+    if (b->stamp[s] != b->gen) {
+        b->stamp[s] = b->gen;
+        b->slot[s] = b->labelled++;
+        int *labels = b->labels + (size_t)b->slot[s] * N;
+        for (int p = 0; p < N; p++) labels[p] = INF;
+        return labels;
+    }
+    return b->labels + (size_t)b->slot[s] * N;
+}
+
+// Room for count more labelled states
+static int reserve_labels(Builder *b, int count) {
+    if (b->labelled + count <= b->label_capacity) return 0;
+    int capacity = b->label_capacity ? b->label_capacity : 1024;
+    while (capacity < b->labelled + count) capacity *= 2;
+    int *labels = realloc(b->labels, (size_t)capacity * b->N * sizeof(int));
+    if (!labels) return -1;
+    b->labels = labels;
+    b->label_capacity = capacity;
+    return 0;
+}
+
+// Set every candidate phase that a path avoiding x covers to INF, by one
+// search from every phase of a over the remaining graph. Each state carries
+// a label per departure phase p, pruned above the dearest candidate for p,
+// and is queued by the least label that dropped, as in profile_search();
+// keys pop in order, so the search is exact once they pass every bound. It
+// stops there, when no candidate is left, or when the pop budget runs out.
+static int witness_search(Builder *b, int x, int a) {
+    int N = b->N;
+    int *bound = b->bound;
+    int max_bound = -1;
+    int64_t pending = 0;
+    for (int p = 0; p < N; p++) bound[p] = -1;
+    for (size_t i = 0; i < (size_t)b->groups * N * N; i++) {
+        int c = b->group_cost[i];
+        if (c == INF) continue;
+        pending++;
+        if (c > bound[i % N]) bound[i % N] = c;
+        if (c > max_bound) max_bound = c;
+    }
+    if (pending == 0) return 0;
+
+    if (b->gen >= UINT32_MAX - 2) {
+        memset(b->stamp, 0, (size_t)b->V * N * sizeof(uint32_t));
+        b->gen = 0;
+    }
+    b->gen++;
+    b->labelled = 0;
+    clear_min_heap(b->heap);
+    if (reserve_labels(b, N) != 0) return -1;
+    for (int p = 0; p < N; p++) {
+        if (bound[p] < 0) continue;
+        size_t origin = (size_t)a * N + p;
+        witness_labels(b, origin)[p] = 0;
+        if (insert_or_decrease(b->heap, origin, 0) != 0) return -1;
+    }
+
+    int64_t budget = WITNESS_POPS_PER_ARC * b->live_arcs / (b->remaining > 0 ? b->remaining : 1);
+    if (budget < WITNESS_MIN_POPS) budget = WITNESS_MIN_POPS;
+    HeapEntry current;
+    while (pending > 0 && extract_min(b->heap, &current)) {
+        if (current.key > max_bound || budget-- == 0) break;
+        size_t s = current.state;
+        int u = s / N;
+        int q = s % N;
+        const IntList *out = &b->out[u];
+        if (reserve_labels(b, out->count) != 0) return -1;
+        const int *from = b->labels + (size_t)b->slot[s] * N;
+        for (int i = 0; i < out->count; i++) {
+            const ChArc *arc = &b->arcs[out->items[i]];
+            if (arc->to == x) continue;
+            int w = b->cost[(size_t)out->items[i] * N + q];
+            if (w == INF) continue;
+            int q2 = (q + arc->residue) % N;
+            size_t t = (size_t)arc->to * N + q2;
+            int *to = witness_labels(b, t);
+            int g = b->group_of[arc->to];
+            int *candidate = g >= 0 ? b->group_cost + (size_t)g * N * N : NULL;
+            int lowered = INF;
+            for (int p = 0; p < N; p++) {
+                if (from[p] == INF) continue;
+                int c = add_costs(from[p], w);
+                if (c > bound[p] || c >= to[p]) continue;
+                to[p] = c;
+                if (c < lowered) lowered = c;
+                // Arriving in phase q2 from departure p takes residue q2 - p
+                if (candidate) {
+                    int *cc = candidate + (size_t)((q2 - p + N) % N) * N + p;
+                    if (*cc != INF && c <= *cc) {
+                        *cc = INF;
+                        pending--;
+                    }
+                }
+            }
+            if (lowered != INF && insert_or_decrease(b->heap, t, lowered) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+// Add shortcut a -> to bypassing x, with cost at the phases no witness
+// covers and full cost at every phase. A parallel arc with the same residue
+// that costs no less at every phase than the full shortcut is dominated and
+// leaves the remaining graph; the shortcut then keeps its full cost so
+// that no phase loses its path. Arcs between remaining vertices are never
+// a part of another shortcut, so nothing unpacks through the one dropped.
+static int add_shortcut(Builder *b, int a, int to, int residue, int x,
+                        const int *cost, const int *full) {
+    int N = b->N;
+    bool dominating = false;
+    IntList *out = &b->out[a];
+    for (int i = 0; i < out->count; i++) {
+        int id = out->items[i];
+        const ChArc *arc = &b->arcs[id];
+        if (arc->to != to || arc->residue != residue) continue;
+        const int *old = b->cost + (size_t)id * N;
+        bool dominated = true;
+        for (int p = 0; p < N && dominated; p++) dominated = full[p] <= old[p];
+        if (!dominated) continue;
+        b->dead[id] = true;
+        if (arc->middle >= 0) b->shortcut_count--;
+        unlink_arc(out, id);
+        unlink_arc(&b->in[to], id);
+        b->live_arcs--;
+        dominating = true;
+        i--;
+    }
+    if (add_arc(b, a, to, residue, x, dominating ? full : cost) < 0) return -1;
+    b->shortcut_count++;
+    return 0;
+}
+
+// Shortcuts out of in-neighbour a that contracting x needs. Counts them,
+// and adds them when apply is set. Returns -1 when out of memory.
+static int contract_from(Builder *b, int x, int a, bool apply) {
+    int N = b->N;
+    const IntList *in = &b->in[x];
+    const IntList *out = &b->out[x];
+    b->groups = 0;
+
+    for (int i = 0; i < in->count; i++) {
+        ChArc first = b->arcs[in->items[i]];
+        if (first.from != a) continue;
+        const int *c1 = b->cost + (size_t)in->items[i] * N;
+        for (int j = 0; j < out->count; j++) {
+            ChArc second = b->arcs[out->items[j]];
+            if (second.to == x || b->contracted[second.to]) continue;
+            const int *c2 = b->cost + (size_t)out->items[j] * N;
+            int *group = candidate_group(b, second.to);
+            if (!group) return -1;
+            for (int k = 0; k < N; k++) {
+                int residue = (first.residue + k + second.residue) % N;
+                // A loop back to the same phase never shortens a path
+                if (second.to == a && residue == 0) continue;
+                int *candidate = group + residue * N;
+                for (int p = 0; p < N; p++) {
+                    int q1 = (p + first.residue) % N;
+                    int q2 = (q1 + k) % N;
+                    int c = add_costs(add_costs(c1[p], b->loop[q1 * N + q2]), c2[q2]);
+                    if (c < candidate[p]) candidate[p] = c;
+                }
+            }
+        }
+    }
+
+    // Drop every phase that has a path at most as cheap around x
+    size_t entries = (size_t)b->groups * N;
+    memcpy(b->group_full, b->group_cost, entries * N * sizeof(int));
+    if (witness_search(b, x, a) != 0) return -1;
+
+    int added = 0;
+    for (size_t i = 0; i < entries; i++) {
+        const int *c = b->group_cost + i * N;
+        bool needed = false;
+        for (int p = 0; p < N && !needed; p++) needed = c[p] != INF;
+        if (!needed) continue;
+        added++;
+        if (apply && add_shortcut(b, a, b->group_head[i / N], i % N, x, c,
+                                  b->group_full + i * N) != 0) {
+            return -1;
+        }
+    }
+    for (int g = 0; g < b->groups; g++) b->group_of[b->group_head[g]] = -1;
+    return added;
+}
+
+// Shortcuts needed to contract x, added when apply is set
+static int contract(Builder *b, int x, bool apply) {
+    loop_closure(b->arcs, b->cost, b->out[x].items, b->out[x].count, x, b->N, b->loop);
+    int visit = ++b->visit;
+    int total = 0;
+    const IntList *in = &b->in[x];
+    for (int i = 0; i < in->count; i++) {
+        int a = b->arcs[in->items[i]].from;
+        if (a == x || b->contracted[a] || b->seen[a] == visit) continue;
+        b->seen[a] = visit;
+        int added = contract_from(b, x, a, apply);
+        if (added < 0) return -1;
+        total += added;
+    }
+    return total;
+}
+
+// Edge difference plus contracted neighbours: cheap, local vertices first.
+// Shortcuts and depth weigh double, which keeps the core of periodic
+// graphs, where shortcuts multiply by residue, sparser.
+// The offset keeps keys non-negative so that -1 can report failure.
+static int priority(Builder *b, int x) {
+    int added = contract(b, x, false);
+    if (added < 0) return -1;
+    int removed = 0;
+    for (int i = 0; i < b->in[x].count; i++) {
+        int a = b->arcs[b->in[x].items[i]].from;
+        if (a != x && !b->contracted[a]) removed++;
+    }
+    for (int i = 0; i < b->out[x].count; i++) {
+        int c = b->arcs[b->out[x].items[i]].to;
+        if (c != x && !b->contracted[c]) removed++;
+    }
+    return INT_MAX / 4 + 2 * (added + b->depth[x]) - removed;
+}
+
+static void free_builder(Builder *b) {
+    if (b->out) {
+        for (int v = 0; v < b->V; v++) free(b->out[v].items);
+    }
+    if (b->in) {
+        for (int v = 0; v < b->V; v++) free(b->in[v].items);
+    }
+    free(b->out);
+    free(b->in);
+    free(b->dead);
+    free(b->contracted);
+    free(b->depth);
+    free(b->stamp);
+    free(b->slot);
+    free(b->labels);
+    if (b->heap) free_heap(b->heap);
+    free(b->group_of);
+    free(b->group_head);
+    free(b->group_cost);
+    free(b->group_full);
+    free(b->bound);
+    free(b->loop);
+    free(b->seen);
+}
+
+// Arcs within the core sit in both lists, so each side of a query can
+// cross the core in any direction
+static bool climbs(const Hierarchy *h, const ChArc *arc) {
+    int from = h->rank[arc->from];
+    int to = h->rank[arc->to];
+    return to >= from || (from >= h->core_rank && to >= h->core_rank);
+}
+
+static bool descends(const Hierarchy *h, const ChArc *arc) {
+    int from = h->rank[arc->from];
+    int to = h->rank[arc->to];
+    return from >= to || (from >= h->core_rank && to >= h->core_rank);
+}
+
+// Sort the arcs into the upward and downward lists by rank, leaving out
+// the dominated ones. Unpacking finds arcs by their endpoints, not their
+// ids, so closing the gaps is safe.
+static Hierarchy *finish_hierarchy(Builder *b, int *rank, int core_rank) {
+    Hierarchy *h = calloc(1, sizeof(Hierarchy));
+    if (!h) return NULL;
+    int V = b->V;
+    int N = b->N;
+    int kept = 0;
+    for (int a = 0; a < b->arc_count; a++) {
+        if (b->dead[a]) continue;
+        b->arcs[kept] = b->arcs[a];
+        memmove(b->cost + (size_t)kept * N, b->cost + (size_t)a * N, N * sizeof(int));
+        kept++;
+    }
+    b->arc_count = kept;
+    h->V = V;
+    h->N = b->N;
+    h->arc_count = b->arc_count;
+    h->shortcut_count = b->shortcut_count;
+    h->arcs = b->arcs;
+    h->cost = b->cost;
+    h->rank = rank;
+    h->core_rank = core_rank;
+    b->arcs = NULL;
+    b->cost = NULL;
+    h->up_offsets = calloc((size_t)V + 1, sizeof(int64_t));
+    h->down_offsets = calloc((size_t)V + 1, sizeof(int64_t));
+    if (!h->up_offsets || !h->down_offsets) {
+        free_hierarchy(h);
+        return NULL;
+    }
+
+    for (int a = 0; a < h->arc_count; a++) {
+        const ChArc *arc = &h->arcs[a];
+        if (climbs(h, arc)) h->up_offsets[arc->from + 1]++;
+        if (descends(h, arc)) h->down_offsets[arc->to + 1]++;
+    }
+    for (int v = 0; v < V; v++) {
+        h->up_offsets[v + 1] += h->up_offsets[v];
+        h->down_offsets[v + 1] += h->down_offsets[v];
+    }
+    h->up_arcs = malloc((h->up_offsets[V] ? h->up_offsets[V] : 1) * sizeof(int));
+    h->down_arcs = malloc((h->down_offsets[V] ? h->down_offsets[V] : 1) * sizeof(int));
+    int64_t *up_fill = malloc((size_t)V * sizeof(int64_t));
+    int64_t *down_fill = malloc((size_t)V * sizeof(int64_t));
+    if (!h->up_arcs || !h->down_arcs || !up_fill || !down_fill) {
+        free(up_fill);
+        free(down_fill);
+        free_hierarchy(h);
+        return NULL;
+    }
+    memcpy(up_fill, h->up_offsets, (size_t)V * sizeof(int64_t));
+    memcpy(down_fill, h->down_offsets, (size_t)V * sizeof(int64_t));
+    for (int a = 0; a < h->arc_count; a++) {
+        const ChArc *arc = &h->arcs[a];
+        if (climbs(h, arc)) h->up_arcs[up_fill[arc->from]++] = a;
+        if (descends(h, arc)) h->down_arcs[down_fill[arc->to]++] = a;
+    }
+    free(up_fill);
+    free(down_fill);
+    return h;
+}
+
+// Contract every vertex in lazily updated priority order: a popped vertex
+// whose fresh priority is worse than the next one is pushed back instead
+Hierarchy *build_hierarchy(const Graph *graph) {
+    if (graph->min_weight < 0) {
+        fprintf(stderr, "Contraction hierarchies need non-negative weights\n");
+        return NULL;
+    }
+    int V = graph->V;
+    int N = graph->N;
+    size_t states = (size_t)V * N;
+
+    Builder b = {0};
+    b.V = V;
+    b.N = N;
+    b.out = calloc(V, sizeof(IntList));
+    b.in = calloc(V, sizeof(IntList));
+    b.contracted = calloc(V, sizeof(bool));
+    b.depth = calloc(V, sizeof(int));
+    b.stamp = calloc(states, sizeof(uint32_t));
+    b.slot = malloc(states * sizeof(int));
+    b.heap = create_min_heap(states);
+    b.group_of = malloc(V * sizeof(int));
+    b.bound = malloc(N * sizeof(int));
+    b.loop = malloc((size_t)N * N * sizeof(int));
+    b.seen = calloc(V, sizeof(int));
+    int *rank = malloc(V * sizeof(int));
+    int *cost = malloc(N * sizeof(int));
+    MinHeap *order = create_min_heap(V);
+    bool ok = b.out && b.in && b.contracted && b.depth && b.stamp && b.slot && b.heap &&
+              b.group_of && b.bound && b.loop && b.seen && rank && cost && order;
+
+    for (int v = 0; v < V && ok; v++) {
+        b.group_of[v] = -1;
+        for (int64_t e = graph->offsets[v]; e < graph->offsets[v + 1] && ok; e++) {
+            for (int p = 0; p < N; p++) cost[p] = graph->weights[(size_t)p * graph->E + e];
+            ok = add_arc(&b, v, graph->targets[e], 1 % N, -1, cost) >= 0;
+        }
+    }
+    for (int v = 0; v < V && ok; v++) {
+        int key = priority(&b, v);
+        ok = key >= 0 && insert_or_decrease(order, v, key) == 0;
+    }
+
+    b.remaining = V;
+    int next_rank = 0;
+    HeapEntry current;
+    while (ok && extract_min(order, &current)) {
+        int x = current.state;
+        if (b.live_arcs > (int64_t)CORE_ARCS_PER_VERTEX * b.remaining) {
+            rank[x] = next_rank++;
+            continue;
+        }
+        int key = priority(&b, x);
+        if (key < 0) {
+            ok = false;
+            break;
+        }
+        if (order->size > 0 && key > order->entries[0].key) {
+            ok = insert_or_decrease(order, x, key) == 0;
+            continue;
+        }
+        if (contract(&b, x, true) < 0) {
+            ok = false;
+            break;
+        }
+        b.contracted[x] = true;
+        b.remaining--;
+        rank[x] = next_rank++;
+        int visit = ++b.visit;
+        for (int i = 0; i < b.in[x].count; i++) {
+            int a = b.arcs[b.in[x].items[i]].from;
+            if (b.contracted[a] || b.seen[a] == visit) continue;
+            b.seen[a] = visit;
+            b.depth[a]++;
+            b.live_arcs -= drop_arcs(&b.out[a], b.arcs, x, true);
+        }
+        visit = ++b.visit;
+        for (int i = 0; i < b.out[x].count; i++) {
+            int c = b.arcs[b.out[x].items[i]].to;
+            if (b.contracted[c] || b.seen[c] == visit) continue;
+            if (b.seen[c] != visit - 1) b.depth[c]++;
+            b.seen[c] = visit;
+            b.live_arcs -= drop_arcs(&b.in[c], b.arcs, x, false);
+        }
+    }
+
+    Hierarchy *h = NULL;
+    if (ok) {
+        h = finish_hierarchy(&b, rank, V - b.remaining);
+        rank = NULL;
+    }
+    if (!h) fprintf(stderr, "Out of memory building contraction hierarchy\n");
+    free(b.arcs);
+    free(b.cost);
+    free_builder(&b);
+    free(rank);
+    free(cost);
+    if (order) free_heap(order);
+    return h;
+}
+
+void free_hierarchy(Hierarchy *h) {
+    free(h->arcs);
+    free(h->cost);
+    free(h->rank);
+    free(h->up_offsets);
+    free(h->up_arcs);
+    free(h->down_offsets);
+    free(h->down_arcs);
+    free(h);
+}
+
+static int unpack_arc(const Hierarchy *h, int a, int phase, IntList *path);
+
+// Append the loops at x that lead from phase q1 to phase q2 at cost
+// loop[q1][q2], found again by a Dijkstra over x's N phases
+static int unpack_loops(const Hierarchy *h, int x, int q1, int q2, IntList *path) {
+    if (q1 == q2) return 0;
+    int N = h->N;
+    const int *ids = h->up_arcs + h->up_offsets[x];
+    int64_t count = h->up_offsets[x + 1] - h->up_offsets[x];
+    int *dist = malloc(N * sizeof(int));
+    int *via = malloc(N * sizeof(int));
+    bool *done = calloc(N, sizeof(bool));
+    int *chain = malloc(N * sizeof(int));
+    int status = -1;
+    if (!dist || !via || !done || !chain) goto out;
+
+    for (int q = 0; q < N; q++) dist[q] = INF;
+    dist[q1] = 0;
+    for (;;) {
+        int q = -1;
+        for (int i = 0; i < N; i++) {
+            if (!done[i] && dist[i] != INF && (q < 0 || dist[i] < dist[q])) q = i;
+        }
+        if (q < 0 || q == q2) break;
+        done[q] = true;
+        for (int64_t i = 0; i < count; i++) {
+            const ChArc *arc = &h->arcs[ids[i]];
+            if (arc->from != x || arc->to != x) continue;
+            int next = (q + arc->residue) % N;
+            int c = add_costs(dist[q], h->cost[(size_t)ids[i] * N + q]);
+            if (c < dist[next]) {
+                dist[next] = c;
+                via[next] = ids[i];
+            }
+        }
+    }
+    if (dist[q2] == INF) goto out;
+
+    // Each phase is entered at most once on a shortest chain
+    int length = 0;
+    for (int q = q2; q != q1; q = (q - h->arcs[via[q]].residue % N + N) % N) chain[length++] = via[q];
+    status = 0;
+    for (int q = q1, i = length - 1; i >= 0 && status == 0; i--) {
+        status = unpack_arc(h, chain[i], q, path);
+        q = (q + h->arcs[chain[i]].residue) % N;
+    }
+out:
+    free(dist);
+    free(via);
+    free(done);
+    free(chain);
+    return status;
+}
+
+// Append the vertices after the tail of arc a, taken in phase phase.
+// A shortcut is split again by finding the arcs into and out of its
+// middle vertex (and loop shift there) whose combined cost it recorded.
+static int unpack_arc(const Hierarchy *h, int a, int phase, IntList *path) {
+    const ChArc *arc = &h->arcs[a];
+    int N = h->N;
+    if (arc->middle < 0) {
+        return list_push(path, arc->to);
+    }
+
+    int x = arc->middle;
+    int target = h->cost[(size_t)a * N + phase];
+    int *loop = malloc((size_t)N * N * sizeof(int));
+    if (!loop) return -1;
+    loop_closure(h->arcs, h->cost, h->up_arcs + h->up_offsets[x],
+                 h->up_offsets[x + 1] - h->up_offsets[x], x, N, loop);
+
+    for (int64_t i = h->down_offsets[x]; i < h->down_offsets[x + 1]; i++) {
+        int e1 = h->down_arcs[i];
+        const ChArc *first = &h->arcs[e1];
+        if (first->from != arc->from || first->from == x) continue;
+        int c1 = h->cost[(size_t)e1 * N + phase];
+        if (c1 == INF) continue;
+        int q1 = (phase + first->residue) % N;
+        for (int64_t j = h->up_offsets[x]; j < h->up_offsets[x + 1]; j++) {
+            int e2 = h->up_arcs[j];
+            const ChArc *second = &h->arcs[e2];
+            if (second->to != arc->to || second->to == x) continue;
+            for (int k = 0; k < N; k++) {
+                if ((first->residue + k + second->residue) % N != arc->residue) continue;
+                int q2 = (q1 + k) % N;
+                int c = add_costs(add_costs(c1, loop[q1 * N + q2]), h->cost[(size_t)e2 * N + q2]);
+                if (c != target) continue;
+                free(loop);
+                if (unpack_arc(h, e1, phase, path) != 0) return -1;
+                if (unpack_loops(h, x, q1, q2, path) != 0) return -1;
+                return unpack_arc(h, e2, q2, path);
+            }
+        }
+    }
+    free(loop);
+    fprintf(stderr, "Shortcut %d -> %d has no matching parts\n", arc->from, arc->to);
+    return -1;
+}
+
+// Forward relaxation of (u, step) along arcs to higher ranks
+static void relax_up(Workspace *ws, const Hierarchy *h, int u, int step, int cost,
+                     int *best, size_t *meet) {
+    int N = h->N;
+    uint32_t labelled = ws->gen;
+    STAT_ADD(ws->stats, relaxations, h->up_offsets[u + 1] - h->up_offsets[u]);
+    for (int64_t i = h->up_offsets[u]; i < h->up_offsets[u + 1]; i++) {
+        int a = h->up_arcs[i];
+        const ChArc *arc = &h->arcs[a];
+        int new_cost = add_costs(cost, h->cost[(size_t)a * N + step]);
+        if (new_cost == INF) continue;
+        size_t t = (size_t)arc->to * N + (step + arc->residue) % N;
+        if (ws->stamp[t] < labelled || (ws->stamp[t] == labelled && new_cost < ws->dist[t])) {
+            ws->dist[t] = new_cost;
+            ws->prev[t] = a;
+            ws->stamp[t] = labelled;
+            STAT_ADD(ws->stats, improvements, 1);
+            STAT_ADD(ws->stats, pushes, 1);
+            if (queue_push(ws->queue, t, new_cost) != 0) {
+                fprintf(stderr, "Out of memory growing queue\n");
+                exit(EXIT_FAILURE);
+            }
+            if (ws->bstamp[t] >= labelled && add_costs(new_cost, ws->bdist[t]) < *best) {
+                *best = new_cost + ws->bdist[t];
+                *meet = t;
+            }
+        }
+    }
+}
+
+// Backward relaxation of (v, step) along arcs from higher ranks: an arc
+// u -> v with residue r reaches (v, step) when it leaves u in step - r
+static void relax_down(Workspace *ws, const Hierarchy *h, int v, int step, int cost,
+                       int *best, size_t *meet) {
+    int N = h->N;
+    uint32_t labelled = ws->gen;
+    STAT_ADD(ws->stats, relaxations, h->down_offsets[v + 1] - h->down_offsets[v]);
+    for (int64_t i = h->down_offsets[v]; i < h->down_offsets[v + 1]; i++) {
+        int a = h->down_arcs[i];
+        const ChArc *arc = &h->arcs[a];
+        int depart = (step - arc->residue % N + N) % N;
+        int new_cost = add_costs(cost, h->cost[(size_t)a * N + depart]);
+        if (new_cost == INF) continue;
+        size_t t = (size_t)arc->from * N + depart;
+        if (ws->bstamp[t] < labelled || (ws->bstamp[t] == labelled && new_cost < ws->bdist[t])) {
+            ws->bdist[t] = new_cost;
+            ws->bnext[t] = a;
+            ws->bstamp[t] = labelled;
+            STAT_ADD(ws->stats, improvements, 1);
+            STAT_ADD(ws->stats, pushes, 1);
+            if (queue_push(ws->bqueue, t, new_cost) != 0) {
+                fprintf(stderr, "Out of memory growing queue\n");
+                exit(EXIT_FAILURE);
+            }
+            if (ws->stamp[t] >= labelled && add_costs(new_cost, ws->dist[t]) < *best) {
+                *best = new_cost + ws->dist[t];
+                *meet = t;
+            }
+        }
+    }
+}
+
+// Stall-on-demand: a forward label on (v, step) is not optimal if some
+// higher vertex already labelled reaches it more cheaply over a downward
+// arc, and then relaxing it can only produce useless labels
+static bool stalled_up(const Workspace *ws, const Hierarchy *h, int v, int step, int cost) {
+    int N = h->N;
+    uint32_t labelled = ws->gen;
+    for (int64_t i = h->down_offsets[v]; i < h->down_offsets[v + 1]; i++) {
+        int a = h->down_arcs[i];
+        int depart = (step - h->arcs[a].residue % N + N) % N;
+        size_t s = (size_t)h->arcs[a].from * N + depart;
+        if (ws->stamp[s] >= labelled && add_costs(ws->dist[s], h->cost[(size_t)a * N + depart]) < cost) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Backward counterpart of stalled_up() over the upward arcs out of v
+static bool stalled_down(const Workspace *ws, const Hierarchy *h, int v, int step, int cost) {
+    int N = h->N;
+    uint32_t labelled = ws->gen;
+    for (int64_t i = h->up_offsets[v]; i < h->up_offsets[v + 1]; i++) {
+        int a = h->up_arcs[i];
+        size_t s = (size_t)h->arcs[a].to * N + (step + h->arcs[a].residue) % N;
+        if (ws->bstamp[s] >= labelled && add_costs(ws->bdist[s], h->cost[(size_t)a * N + step]) < cost) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Collect the arcs from the origin state through meet to end and unpack them
+static int *unpack_path(Workspace *ws, const Hierarchy *h, int start, size_t meet, int *path_len) {
+    int N = h->N;
+    int head = 0;
+    for (size_t s = meet; ws->prev[s] != -1; ) {
+        const ChArc *arc = &h->arcs[ws->prev[s]];
+        s = (size_t)arc->from * N + (s % N - arc->residue % N + N) % N;
+        head++;
+    }
+    int tail = 0;
+    for (size_t s = meet; ws->bnext[s] != -1; ) {
+        const ChArc *arc = &h->arcs[ws->bnext[s]];
+        s = (size_t)arc->to * N + (s % N + arc->residue) % N;
+        tail++;
+    }
+
+    int *arcs = malloc((head + tail + 1) * sizeof(int));
+    int *phases = malloc((head + tail + 1) * sizeof(int));
+    IntList path = {0};
+    int status = arcs && phases ? 0 : -1;
+    if (status == 0) {
+        int i = head;
+        for (size_t s = meet; ws->prev[s] != -1; ) {
+            const ChArc *arc = &h->arcs[ws->prev[s]];
+            int depart = (s % N - arc->residue % N + N) % N;
+            arcs[--i] = ws->prev[s];
+            phases[i] = depart;
+            s = (size_t)arc->from * N + depart;
+        }
+        i = head;
+        for (size_t s = meet; ws->bnext[s] != -1; ) {
+            const ChArc *arc = &h->arcs[ws->bnext[s]];
+            arcs[i] = ws->bnext[s];
+            phases[i++] = s % N;
+            s = (size_t)arc->to * N + (s % N + arc->residue) % N;
+        }
+        status = list_push(&path, start);
+    }
+    for (int i = 0; i < head + tail && status == 0; i++) {
+        status = unpack_arc(h, arcs[i], phases[i], &path);
+    }
+    free(arcs);
+    free(phases);
+    if (status != 0) {
+        free(path.items);
+        *path_len = 0;
+        return NULL;
+    }
+    *path_len = path.count;
+    return path.items;
+}
+
+// Bidirectional upward search. The forward side climbs from (start, phase),
+// the backward side climbs the reversed downward arcs from every phase of
+// end. Unlike a plain bidirectional Dijkstra neither side sees the whole
+// graph, so each side runs until its own frontier reaches best.
+int *ch_search(Workspace *ws, int start, int phase, int end, int *path_len) {
+    const Hierarchy *h = ws->config->hierarchy;
+    int N = h->N;
+    begin_search(ws);
+    uint32_t labelled = ws->gen;
+    uint32_t settled = ws->gen + 1;
+
+    int best = INF;
+    size_t meet = 0;
+
+    size_t origin = (size_t)start * N + phase;
+    ws->dist[origin] = 0;
+    ws->prev[origin] = -1;
+    ws->stamp[origin] = labelled;
+    queue_push(ws->queue, origin, 0);
+    for (int p = 0; p < N; p++) {
+        size_t s = (size_t)end * N + p;
+        ws->bdist[s] = 0;
+        ws->bnext[s] = -1;
+        ws->bstamp[s] = labelled;
+        queue_push(ws->bqueue, s, 0);
+    }
+    STAT_ADD(ws->stats, pushes, 1 + N);
+    if (start == end) {
+        best = 0;
+        meet = origin;
+    }
+
+    bool forward_done = false;
+    bool backward_done = false;
+    bool forward_turn = true;
+    HeapEntry current;
+    while (!forward_done || !backward_done) {
+        bool forward = backward_done || (!forward_done && forward_turn);
+        forward_turn = !forward_turn;
+        STAT_MAX(ws->stats, max_queue, queue_size(ws->queue) + queue_size(ws->bqueue));
+        if (forward) {
+            if (!pop_state(ws->queue, &current) || current.key >= best) {
+                forward_done = true;
+                continue;
+            }
+            STAT_ADD(ws->stats, pops, 1);
+            size_t s = current.state;
+            if (ws->stamp[s] == settled) {
+                STAT_ADD(ws->stats, stale_pops, 1);
+                continue;
+            }
+            ws->stamp[s] = settled;
+            STAT_ADD(ws->stats, settled, 1);
+            if (stalled_up(ws, h, s / N, s % N, ws->dist[s])) continue;
+            relax_up(ws, h, s / N, s % N, ws->dist[s], &best, &meet);
+        } else {
+            if (!pop_state(ws->bqueue, &current) || current.key >= best) {
+                backward_done = true;
+                continue;
+            }
+            STAT_ADD(ws->stats, pops, 1);
+            size_t s = current.state;
+            if (ws->bstamp[s] == settled) {
+                STAT_ADD(ws->stats, stale_pops, 1);
+                continue;
+            }
+            ws->bstamp[s] = settled;
+            STAT_ADD(ws->stats, settled, 1);
+            if (stalled_down(ws, h, s / N, s % N, ws->bdist[s])) continue;
+            relax_down(ws, h, s / N, s % N, ws->bdist[s], &best, &meet);
+        }
+    }
+
+    *path_len = 0;
+    if (best == INF) return NULL;
+    return unpack_path(ws, h, start, meet, path_len);
+}
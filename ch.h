@@ -0,0 +1,50 @@
+#ifndef CH_H
+#define CH_H
+
+#include <stdint.h>
+#include "graph.h"
+#include "search.h"
+
+// An input edge or a shortcut of the hierarchy. A shortcut stands for
+// a path from -> middle -> to, possibly with loops at middle, and takes
+// residue hops modulo N, so leaving in phase p it arrives in phase
+// (p + residue) % N. Its cost depends on the departure phase.
+typedef struct ChArc {
+    int from;
+    int to;
+    int residue;
+    int middle;          // Contracted vertex bypassed, -1 for an input edge
+} ChArc;
+
+// Contraction hierarchy over periodic weights
+//
+// Vertices are contracted one at a time in rank order; contracting x adds
+// a shortcut a -> b for every higher neighbour pair whose best path through
+// x (per departure phase) has no witness avoiding x; a shortcut that costs
+// no more at every phase than a parallel arc replaces it. Each arc is stored
+// once, in the upward list of its tail when it climbs or in the downward
+// list of its head when it descends. Loops sit in both lists, since
+// waiting out phases on a loop can happen on either side of the peak.
+// Contraction stops when the remaining graph gets dense; those vertices
+// form the core, whose arcs also sit in both lists.
+typedef struct Hierarchy {
+    int V;
+    int N;
+    int arc_count;
+    int shortcut_count;
+    ChArc *arcs;
+    int *cost;           // arc_count * N, arc-major: cost[a * N + p]
+    int *rank;           // Contraction order of each vertex
+    int core_rank;       // Vertices ranked here or above were never contracted
+
+    int64_t *up_offsets; // Arcs out of v to higher (or equal) rank
+    int *up_arcs;
+    int64_t *down_offsets; // Arcs into v from higher (or equal) rank
+    int *down_arcs;
+} Hierarchy;
+
+Hierarchy *build_hierarchy(const Graph *graph);
+void free_hierarchy(Hierarchy *hierarchy);
+int *ch_search(Workspace *ws, int start, int phase, int end, int *path_len);
+
+#endif // CH_H
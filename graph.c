@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include "graph.h"
+
+// Function to create a new graph
+Graph *create_graph(int V, int N) {
+    Graph *graph = malloc(sizeof(Graph));
+    if (!graph) return NULL;
+    graph->V = V;
+    graph->N = N;
+    graph->E = 0;
+    graph->min_weight = 0;
+    graph->max_weight = 0;
+    graph->offsets = NULL;
+    graph->targets = NULL;
+    graph->weights = NULL;
+    graph->rev_offsets = NULL;
+    graph->rev_sources = NULL;
+    graph->rev_weights = NULL;
+    graph->mapping = NULL;
+    graph->mapping_size = 0;
+    return graph;
+}
+
+// Build the reversed CSR arrays from the frozen forward ones
+int graph_build_reverse(Graph *graph) {
+    if (graph->rev_offsets) return 0;
+    int V = graph->V;
+    int N = graph->N;
+    int64_t E = graph->E;
+    size_t nweights = (size_t)N * E;
+
+    int64_t *offsets = calloc((size_t)V + 1, sizeof(int64_t));
+    int64_t *fill = malloc(((size_t)V + 1) * sizeof(int64_t));
+    int *sources = malloc((E ? E : 1) * sizeof(int));
+    int *weights = malloc((nweights ? nweights : 1) * sizeof(int));
+    if (!offsets || !fill || !sources || !weights) {
+        fprintf(stderr, "Out of memory building reverse graph\n");
+        free(offsets);
+        free(fill);
+        free(sources);
+        free(weights);
+        return -1;
+    }
+
+    // Count in-degrees, prefix-sum them into row offsets, then scatter
+    for (int64_t e = 0; e < E; e++) offsets[graph->targets[e] + 1]++;
+    for (int v = 0; v < V; v++) offsets[v + 1] += offsets[v];
+    memcpy(fill, offsets, ((size_t)V + 1) * sizeof(int64_t));
+    for (int u = 0; u < V; u++) {
+        for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            int64_t r = fill[graph->targets[e]]++;
+            sources[r] = u;
+            for (int p = 0; p < N; p++) {
+                weights[(size_t)p * E + r] = graph->weights[(size_t)p * E + e];
+            }
+        }
+    }
+    free(fill);
+
+    graph->rev_offsets = offsets;
+    graph->rev_sources = sources;
+    graph->rev_weights = weights;
+    return 0;
+}
+
+// FNV-1a over the frozen arrays, identifying one version of the graph
+uint64_t graph_fingerprint(const Graph *graph) {
+    uint64_t hash = 1469598103934665603ull;
+    const unsigned char *parts[3] = {
+        (const unsigned char *)graph->offsets,
+        (const unsigned char *)graph->targets,
+        (const unsigned char *)graph->weights
+    };
+    size_t sizes[3] = {
+        ((size_t)graph->V + 1) * sizeof(int64_t),
+        graph->E * sizeof(int),
+        (size_t)graph->N * graph->E * sizeof(int)
+    };
+    for (int k = 0; k < 3; k++) {
+        for (size_t i = 0; i < sizes[k]; i++) {
+            hash ^= parts[k][i];
+            hash *= 1099511628211ull;
+        }
+    }
+    hash ^= (uint64_t)graph->N << 32 | (uint32_t)graph->V;
+    return hash;
+}
+
+void free_graph(Graph *graph) {
+    if (graph->mapping) {
+        munmap(graph->mapping, graph->mapping_size);
+    } else {
+        free(graph->offsets);
+        free(graph->targets);
+        free(graph->weights);
+    }
+    free(graph->rev_offsets);
+    free(graph->rev_sources);
+    free(graph->rev_weights);
+    free(graph);
+}
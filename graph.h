@@ -0,0 +1,44 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Structure for the graph
+//
+// Edges are stored in a compressed sparse row (CSR) layout, filled by the
+// parser or mapped from a snapshot: the out-edges of vertex u are offsets[u] .. offsets[u + 1] - 1, and the
+// weight of edge e in phase p is weights[p * E + e], so all weights of one
+// phase are contiguous and a neighbor scan is a linear walk.
+// Vertex ids fit in an int; edge and state indices are 64-bit.
+typedef struct Graph {
+    int V;               // Number of vertices
+    int N;               // Period of weights
+    int64_t E;           // Number of edges
+    int min_weight;      // Smallest weight over all edges and phases
+    int max_weight;      // Largest weight over all edges and phases
+
+    int64_t *offsets;    // V + 1 row offsets into targets
+    int *targets;        // Target vertex of each edge
+    int *weights;        // N * E weights, phase-major
+
+    // Reversed CSR, built on demand by graph_build_reverse(): the in-edges
+    // of v are rev_offsets[v] .. rev_offsets[v + 1] - 1, with their source
+    // vertex and their weights laid out phase-major like the forward arrays
+    int64_t *rev_offsets;
+    int *rev_sources;
+    int *rev_weights;
+
+    // Snapshot mapping backing offsets, targets and weights, or the private
+    // weight mapping of an updated version, if any
+    void *mapping;
+    size_t mapping_size;
+} Graph;
+
+Graph *create_graph(int V, int N);
+int graph_build_reverse(Graph *graph);
+uint64_t graph_fingerprint(const Graph *graph);
+void free_graph(Graph *graph);
+
+#endif // GRAPH_H
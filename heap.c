@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heap.h"
+
+#define HEAP_INITIAL_CAPACITY 1024
+
+// Function to initialize a min-heap able to index the given number of states
+MinHeap *create_min_heap(size_t states) {
+    MinHeap *heap = malloc(sizeof(MinHeap));
+    if (!heap) return NULL;
+    heap->size = 0;
+    heap->capacity = HEAP_INITIAL_CAPACITY;
+    heap->entries = malloc(heap->capacity * sizeof(HeapEntry));
+    heap->pos = malloc((states ? states : 1) * sizeof(uint32_t));
+    heap->states = states;
+    if (!heap->entries || !heap->pos) {
+        free_heap(heap);
+        return NULL;
+    }
+    memset(heap->pos, 0xff, states * sizeof(uint32_t));
+    return heap;
+}
+
+// Move the entry at idx up until its parent is no larger
+static void heapify_up(MinHeap *heap, size_t idx) {
+    HeapEntry entry = heap->entries[idx];
+    while (idx) {
+        size_t parent = (idx - 1) / HEAP_ARITY;
+        if (heap->entries[parent].key <= entry.key) break;
+        heap->entries[idx] = heap->entries[parent];
+        heap->pos[heap->entries[idx].state] = idx;
+        idx = parent;
+    }
+    heap->entries[idx] = entry;
+    heap->pos[entry.state] = idx;
+}
+
+// Move the entry at idx down until no child is smaller
+static void heapify_down(MinHeap *heap, size_t idx) {
+    HeapEntry entry = heap->entries[idx];
+    for (;;) {
+        size_t first = idx * HEAP_ARITY + 1;
+        if (first >= heap->size) break;
+        size_t last = first + HEAP_ARITY < heap->size ? first + HEAP_ARITY : heap->size;
+        size_t smallest = first;
+        for (size_t child = first + 1; child < last; child++) {
+            if (heap->entries[child].key < heap->entries[smallest].key) {
+                smallest = child;
+            }
+        }
+        if (heap->entries[smallest].key >= entry.key) break;
+        heap->entries[idx] = heap->entries[smallest];
+        heap->pos[heap->entries[idx].state] = idx;
+        idx = smallest;
+    }
+    heap->entries[idx] = entry;
+    heap->pos[entry.state] = idx;
+}
+
+// Insert a state, or lower its key if it is already queued.
+// Returns -1 if the heap could not grow.
+int insert_or_decrease(MinHeap *heap, uint32_t state, int key) {
+    uint32_t idx = heap->pos[state];
+    if (idx != HEAP_ABSENT) {
+        if (key < heap->entries[idx].key) {
+            heap->entries[idx].key = key;
+            heapify_up(heap, idx);
+        }
+        return 0;
+    }
+
+    if (heap->size == heap->capacity) {
+        size_t capacity = heap->capacity * 2;
+        HeapEntry *entries = realloc(heap->entries, capacity * sizeof(HeapEntry));
+        if (!entries) return -1;
+        heap->entries = entries;
+        heap->capacity = capacity;
+    }
+    heap->entries[heap->size].key = key;
+    heap->entries[heap->size].state = state;
+    heapify_up(heap, heap->size++);
+    return 0;
+}
+
+// Remove the smallest entry into *out; false when the heap is empty
+bool extract_min(MinHeap *heap, HeapEntry *out) {
+    if (!heap->size) return false;
+    *out = heap->entries[0];
+    heap->pos[out->state] = HEAP_ABSENT;
+    if (--heap->size) {
+        heap->entries[0] = heap->entries[heap->size];
+        heapify_down(heap, 0);
+    }
+    return true;
+}
+
+// Empty the heap in O(size), leaving pos all HEAP_ABSENT for the next query
+void clear_min_heap(MinHeap *heap) {
+    for (size_t i = 0; i < heap->size; ++i) {
+        heap->pos[heap->entries[i].state] = HEAP_ABSENT;
+    }
+    heap->size = 0;
+}
+
+void free_heap(MinHeap *heap) {
+    free(heap->entries);
+    free(heap->pos);
+    free(heap);
+}
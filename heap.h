@@ -0,0 +1,40 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HEAP_ARITY 4
+#define HEAP_ABSENT UINT32_MAX
+
+// Entry of the priority queue, stored by value
+typedef struct HeapEntry {
+    int key;             // Priority (the tentative cost)
+    uint32_t state;      // Flattened state id: vertex * N + phase
+} HeapEntry;
+
+// Indexed 4-ary min-heap over (vertex, phase) states
+//
+// pos[state] is the state's slot in entries, or HEAP_ABSENT, so a state is
+// in the heap at most once and an improved cost is a decrease-key instead of
+// a second push. entries grows by doubling; nothing is allocated per push.
+typedef struct MinHeap {
+    HeapEntry *entries;
+    size_t size;
+    size_t capacity;
+    uint32_t *pos;       // One slot per state
+    size_t states;
+} MinHeap;
+
+MinHeap *create_min_heap(size_t states);
+int insert_or_decrease(MinHeap *heap, uint32_t state, int key);
+bool extract_min(MinHeap *heap, HeapEntry *out);
+void clear_min_heap(MinHeap *heap);
+void free_heap(MinHeap *heap);
+
+static inline bool heap_contains(const MinHeap *heap, uint32_t state) {
+    return heap->pos[state] != HEAP_ABSENT;
+}
+
+#endif // HEAP_H
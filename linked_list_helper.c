@@ -147,19 +147,32 @@ GraphNode* read_graph_file(const char *filename) {
 
     GraphNode *head = NULL;
 
-    char line[256];
-    while (fgets(line, sizeof(line), file)) {
+    // Lines and weight lists are sized dynamically, so long records are
+    // neither truncated nor limited to a fixed number of weights
+    char *line = NULL;
+    size_t line_size = 0;
+    int *weights = NULL;
+    int weights_size = 0;
+    while (getline(&line, &line_size, file) != -1) {
         line[strcspn(line, "\n")] = 0;
 
         int from_node, to_node;
         if (sscanf(line, "%d %d", &from_node, &to_node) == 2) {
-            int weights[10];
             int weight_count = 0;
             char *token = strtok(line, " ");
             token = strtok(NULL, " ");
             token = strtok(NULL, " ");
 
-            while (token != NULL && weight_count < 10) {
+            while (token != NULL) {
+                if (weight_count == weights_size) {
+                    int *grown = realloc(weights, (weights_size ? weights_size * 2 : 16) * sizeof(int));
+                    if (grown == NULL) {
+                        perror("Error allocating memory for weights");
+                        break;
+                    }
+                    weights = grown;
+                    weights_size = weights_size ? weights_size * 2 : 16;
+                }
                 weights[weight_count] = atoi(token);
                 weight_count++;
                 token = strtok(NULL, " ");
@@ -170,6 +183,8 @@ GraphNode* read_graph_file(const char *filename) {
             add_edge(head, from_node, to_node, weights, weight_count);
         }
     }
+    free(line);
+    free(weights);
 
     fclose(file);
     return head;
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "matrix.h"
+#include "reach.h"
+#include "reorder.h"
+
+// Read one line of whitespace-separated vertex ids below V, skipping
+// blank lines before it. Returns -1 at end of input or on a bad id.
+static int read_vertex_line(FILE *in, int V, const char *what, int **out, int *count) {
+    int c;
+    do c = getc(in); while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+    if (c == EOF) {
+        fprintf(stderr, "Expected a line of %s\n", what);
+        return -1;
+    }
+
+    int capacity = 64;
+    int n = 0;
+    int *ids = malloc(capacity * sizeof(int));
+    if (!ids) {
+        fprintf(stderr, "Out of memory reading %s\n", what);
+        return -1;
+    }
+    for (;;) {
+        while (c == ' ' || c == '\t' || c == '\r') c = getc(in);
+        if (c == '\n' || c == EOF) break;
+        long v = 0;
+        if (c < '0' || c > '9') v = V;
+        while (c >= '0' && c <= '9' && v < V) {
+            v = v * 10 + (c - '0');
+            c = getc(in);
+        }
+        if (v >= V) {
+            fprintf(stderr, "Invalid %s: expected vertex ids below %d\n", what, V);
+            free(ids);
+            return -1;
+        }
+        if (n == capacity) {
+            capacity *= 2;
+            int *grown = realloc(ids, capacity * sizeof(int));
+            if (!grown) {
+                fprintf(stderr, "Out of memory reading %s\n", what);
+                free(ids);
+                return -1;
+            }
+            ids = grown;
+        }
+        ids[n++] = (int)v;
+    }
+    *out = ids;
+    *count = n;
+    return 0;
+}
+
+// Read a line of sources and a line of targets and make room for their
+// costs, and their paths when asked, provided the costs fit mem_budget
+Matrix *read_matrix(FILE *in, int V, bool paths, size_t mem_budget) {
+    Matrix *matrix = calloc(1, sizeof(Matrix));
+    if (!matrix) return NULL;
+    if (read_vertex_line(in, V, "sources", &matrix->sources, &matrix->rows) != 0 ||
+        read_vertex_line(in, V, "targets", &matrix->targets, &matrix->cols) != 0) {
+        free_matrix(matrix);
+        return NULL;
+    }
+
+    size_t cells = (size_t)matrix->rows * matrix->cols;
+    size_t cell_bytes = paths ? sizeof(int) + sizeof(int *) + sizeof(int) : sizeof(int);
+    if (cells * cell_bytes > mem_budget) {
+        fprintf(stderr, "%d x %d matrix needs %zu bytes, over the memory budget of %zu\n",
+                matrix->rows, matrix->cols, cells * cell_bytes, mem_budget);
+        free_matrix(matrix);
+        return NULL;
+    }
+    matrix->cost = malloc(cells * sizeof(int));
+    if (paths) {
+        matrix->path = calloc(cells, sizeof(int *));
+        matrix->path_len = calloc(cells, sizeof(int));
+    }
+    if (!matrix->cost || (paths && (!matrix->path || !matrix->path_len))) {
+        fprintf(stderr, "Out of memory allocating %d x %d matrix\n", matrix->rows, matrix->cols);
+        free_matrix(matrix);
+        return NULL;
+    }
+    return matrix;
+}
+
+// Fill one row with a single search from its source that runs until
+// every reachable target is settled
+void answer_matrix_row(Workspace *ws, Matrix *matrix, int row) {
+    int N = ws->graph->N;
+    const int *to_inner = ws->config->ordering ? ws->config->ordering->to_inner : NULL;
+    const struct Reachability *reach = ws->config->reach;
+    int *cost = matrix->cost + (size_t)row * matrix->cols;
+    int start = to_inner ? to_inner[matrix->sources[row]] : matrix->sources[row];
+    for (int j = 0; j < matrix->cols; j++) cost[j] = INF;
+
+    // Unreachable targets would keep the search going until it runs dry
+    int *targets = malloc(matrix->cols * sizeof(int));
+    if (!targets) {
+        fprintf(stderr, "Out of memory answering matrix row %d\n", row);
+        exit(EXIT_FAILURE);
+    }
+    int ntargets = 0;
+    for (int j = 0; j < matrix->cols; j++) {
+        int end = to_inner ? to_inner[matrix->targets[j]] : matrix->targets[j];
+        if (!reach || may_reach(reach, start, end)) targets[ntargets++] = end;
+    }
+    if (ntargets == 0) {
+        free(targets);
+        return;
+    }
+    search_targets(ws, start, 0, targets, ntargets);
+    free(targets);
+
+    // Frontier labels of a target are no cheaper than its settled one
+    for (int j = 0; j < matrix->cols; j++) {
+        int end = to_inner ? to_inner[matrix->targets[j]] : matrix->targets[j];
+        for (int p = 0; p < N; p++) {
+            int d = state_dist(ws, (size_t)end * N + p);
+            if (d < cost[j]) cost[j] = d;
+        }
+        if (!matrix->path || cost[j] == INF) continue;
+        size_t cell = (size_t)row * matrix->cols + j;
+        int *path = extract_path(ws, end, &matrix->path_len[cell]);
+        if (path && ws->config->ordering) {
+            const int *to_outer = ws->config->ordering->to_outer;
+            for (int i = 0; i < matrix->path_len[cell]; i++) path[i] = to_outer[path[i]];
+        }
+        matrix->path[cell] = path;
+    }
+}
+
+void answer_matrix(Workspace *ws, Matrix *matrix) {
+    for (int row = 0; row < matrix->rows; row++) answer_matrix_row(ws, matrix, row);
+}
+
+// Write the decimal digits of a non-negative value at at; returns the end
+static char *put_int(char *at, int value) {
+    char digits[12];
+    int n = 0;
+    do digits[n++] = '0' + value % 10; while ((value /= 10) > 0);
+    while (n > 0) *at++ = digits[--n];
+    return at;
+}
+
+// One comma-separated line per source after a header line of targets;
+// unreachable cells are left empty. Lines are formatted into one buffer
+// and written whole.
+static int write_csv(FILE *out, const Matrix *matrix) {
+    char *line = malloc(((size_t)matrix->cols + 1) * 12 + 1);
+    if (!line) {
+        fprintf(stderr, "Out of memory writing matrix\n");
+        return -1;
+    }
+    char *at = line;
+    for (int j = 0; j < matrix->cols; j++) {
+        *at++ = ',';
+        at = put_int(at, matrix->targets[j]);
+    }
+    *at++ = '\n';
+    int status = fwrite(line, 1, at - line, out) == (size_t)(at - line) ? 0 : -1;
+    for (int i = 0; i < matrix->rows && status == 0; i++) {
+        const int *cost = matrix->cost + (size_t)i * matrix->cols;
+        at = put_int(line, matrix->sources[i]);
+        for (int j = 0; j < matrix->cols; j++) {
+            *at++ = ',';
+            if (cost[j] != INF) at = put_int(at, cost[j]);
+        }
+        *at++ = '\n';
+        if (fwrite(line, 1, at - line, out) != (size_t)(at - line)) status = -1;
+    }
+    free(line);
+    return status;
+}
+
+static int write_binary(FILE *out, const Matrix *matrix) {
+    MatrixHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+    header.version = MATRIX_VERSION;
+    header.header_size = sizeof(MatrixHeader);
+    header.rows = matrix->rows;
+    header.cols = matrix->cols;
+
+    int32_t *row = malloc((matrix->cols > 0 ? matrix->cols : 1) * sizeof(int32_t));
+    if (!row) {
+        fprintf(stderr, "Out of memory writing matrix\n");
+        return -1;
+    }
+    int status = 0;
+    if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+        fwrite(matrix->sources, sizeof(int32_t), matrix->rows, out) != (size_t)matrix->rows ||
+        fwrite(matrix->targets, sizeof(int32_t), matrix->cols, out) != (size_t)matrix->cols) {
+        status = -1;
+    }
+    for (int i = 0; i < matrix->rows && status == 0; i++) {
+        const int *cost = matrix->cost + (size_t)i * matrix->cols;
+        for (int j = 0; j < matrix->cols; j++) row[j] = cost[j] == INF ? -1 : cost[j];
+        if (fwrite(row, sizeof(int32_t), matrix->cols, out) != (size_t)matrix->cols) status = -1;
+    }
+    free(row);
+    return status;
+}
+
+int write_matrix(FILE *out, const Matrix *matrix, MatrixFormat format) {
+    int status = format == MATRIX_BINARY ? write_binary(out, matrix) : write_csv(out, matrix);
+    if (status != 0) fprintf(stderr, "Failed writing matrix\n");
+    return status;
+}
+
+// One line per cell in row-major order: "source target cost: path", or
+// "source target: No path found"
+int write_matrix_paths(FILE *out, const Matrix *matrix) {
+    for (int i = 0; i < matrix->rows; i++) {
+        for (int j = 0; j < matrix->cols; j++) {
+            size_t cell = (size_t)i * matrix->cols + j;
+            if (!matrix->path[cell]) {
+                fprintf(out, "%d %d: No path found\n", matrix->sources[i], matrix->targets[j]);
+                continue;
+            }
+            fprintf(out, "%d %d %d:", matrix->sources[i], matrix->targets[j], matrix->cost[cell]);
+            for (int k = 0; k < matrix->path_len[cell]; k++) fprintf(out, " %d", matrix->path[cell][k]);
+            fputc('\n', out);
+        }
+    }
+    if (ferror(out)) {
+        fprintf(stderr, "Failed writing matrix paths\n");
+        return -1;
+    }
+    return 0;
+}
+
+void free_matrix(Matrix *matrix) {
+    if (matrix->path) {
+        size_t cells = (size_t)matrix->rows * matrix->cols;
+        for (size_t cell = 0; cell < cells; cell++) free(matrix->path[cell]);
+    }
+    free(matrix->sources);
+    free(matrix->targets);
+    free(matrix->cost);
+    free(matrix->path);
+    free(matrix->path_len);
+    free(matrix);
+}
@@ -0,0 +1,49 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "search.h"
+
+#define MATRIX_MAGIC "A8MATRX"
+#define MATRIX_VERSION 1
+
+typedef enum MatrixFormat {
+    MATRIX_CSV,      // Header row of targets, then one row per source
+    MATRIX_BINARY    // MatrixHeader followed by int32 arrays
+} MatrixFormat;
+
+// Header of a binary matrix
+//
+// It is followed by rows int32 source ids, cols int32 target ids and the
+// rows x cols int32 costs in row-major order, -1 where the target is
+// unreachable. All fields are host byte order.
+typedef struct MatrixHeader {
+    char magic[8];       // MATRIX_MAGIC, NUL padded
+    uint32_t version;
+    uint32_t header_size;
+    int32_t rows;
+    int32_t cols;
+} MatrixHeader;
+
+// Costs from every source to every target, departing in phase 0. Each row
+// is one multi-target search that stops once the last target settles.
+typedef struct Matrix {
+    int rows;
+    int cols;
+    int *sources;        // Outer ids, one per row
+    int *targets;        // Outer ids, one per column
+    int *cost;           // rows x cols, INF when unreachable
+    int **path;          // rows x cols when paths are kept, else NULL
+    int *path_len;
+} Matrix;
+
+Matrix *read_matrix(FILE *in, int V, bool paths, size_t mem_budget);
+void answer_matrix_row(Workspace *ws, Matrix *matrix, int row);
+void answer_matrix(Workspace *ws, Matrix *matrix);
+int write_matrix(FILE *out, const Matrix *matrix, MatrixFormat format);
+int write_matrix_paths(FILE *out, const Matrix *matrix);
+void free_matrix(Matrix *matrix);
+
+#endif // MATRIX_H
@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "oracle.h"
+
+#define ORACLE_ALIGN 64
+
+static int rank_width(const Graph *graph) {
+    int64_t max_degree = 0;
+    for (int v = 0; v < graph->V; v++) {
+        int64_t degree = graph->offsets[v + 1] - graph->offsets[v];
+        if (degree > max_degree) max_degree = degree;
+    }
+    if (max_degree < UINT8_MAX) return 1;
+    if (max_degree < UINT16_MAX) return 2;
+    return 4;
+}
+
+static inline uint32_t get_rank(const Oracle *oracle, size_t i) {
+    switch (oracle->rank_bytes) {
+    case 1: return ((const uint8_t *)oracle->next)[i];
+    case 2: return ((const uint16_t *)oracle->next)[i];
+    default: return ((const uint32_t *)oracle->next)[i];
+    }
+}
+
+static inline uint32_t no_rank(const Oracle *oracle) {
+    return oracle->rank_bytes == 4 ? UINT32_MAX : (1u << (8 * oracle->rank_bytes)) - 1;
+}
+
+static inline void set_rank(Oracle *oracle, size_t i, uint32_t rank) {
+    switch (oracle->rank_bytes) {
+    case 1: ((uint8_t *)oracle->next)[i] = rank; break;
+    case 2: ((uint16_t *)oracle->next)[i] = rank; break;
+    default: ((uint32_t *)oracle->next)[i] = rank; break;
+    }
+}
+
+// Bytes of the next-hop table for graph
+size_t oracle_bytes(const Graph *graph) {
+    return (size_t)graph->V * graph->V * graph->N * rank_width(graph);
+}
+
+typedef struct OracleBuild {
+    Oracle *oracle;
+    const Graph *graph;
+    const int64_t *rev_edge;   // Forward edge index of each reverse slot
+    Engine engine;
+    pthread_mutex_t lock;
+    int next_target;
+    int failed;
+} OracleBuild;
+
+// Workers read failed under the lock to stop taking targets
+static void fail_build(OracleBuild *build) {
+    pthread_mutex_lock(&build->lock);
+    build->failed = 1;
+    pthread_mutex_unlock(&build->lock);
+}
+
+// Backward search from every phase of target t; fills row t of the
+// next-hop table
+static void oracle_target(OracleBuild *build, int t, int *dist, uint32_t *stamp,
+                          uint32_t gen, Queue *queue) {
+    const Graph *graph = build->graph;
+    Oracle *oracle = build->oracle;
+    int V = graph->V;
+    int N = graph->N;
+    size_t row = (size_t)t * V * N;
+    uint32_t settled = gen + 1;
+
+    clear_queue(queue);
+    for (int p = 0; p < N; p++) {
+        size_t s = (size_t)t * N + p;
+        dist[s] = 0;
+        stamp[s] = gen;
+        if (queue_push(queue, s, 0) != 0) {
+            fail_build(build);
+            return;
+        }
+    }
+
+    HeapEntry current;
+    int popped;
+    while ((popped = queue_pop(queue, &current)) > 0) {
+        size_t s = current.state;
+        if (stamp[s] == settled) continue;
+        stamp[s] = settled;
+        int v = s / N;
+        int step = s % N;
+        int prev_step = (step - 1 + N) % N;
+        const int *weights = graph->rev_weights + (size_t)prev_step * graph->E;
+        for (int64_t r = graph->rev_offsets[v]; r < graph->rev_offsets[v + 1]; r++) {
+            int u = graph->rev_sources[r];
+            if (u == t) continue;
+            int new_cost = dist[s] + weights[r];
+            size_t w = (size_t)u * N + prev_step;
+            if (stamp[w] < gen || (stamp[w] == gen && new_cost < dist[w])) {
+                dist[w] = new_cost;
+                stamp[w] = gen;
+                set_rank(oracle, row + w, build->rev_edge[r] - graph->offsets[u]);
+                if (queue_push(queue, w, new_cost) != 0) {
+                    fail_build(build);
+                    return;
+                }
+            }
+        }
+    }
+    if (popped < 0) fail_build(build);
+}
+
+static void *oracle_worker(void *arg) {
+    OracleBuild *build = arg;
+    const Graph *graph = build->graph;
+    size_t states = (size_t)graph->V * graph->N;
+    int *dist = malloc(states * sizeof(int));
+    uint32_t *stamp = calloc(states, sizeof(uint32_t));
+    Queue *queue = create_queue(build->engine, states, graph->max_weight);
+    if (!dist || !stamp || !queue) {
+        fail_build(build);
+    } else {
+        uint32_t gen = 0;
+        for (;;) {
+            pthread_mutex_lock(&build->lock);
+            int t = build->failed ? graph->V : build->next_target++;
+            pthread_mutex_unlock(&build->lock);
+            if (t >= graph->V) break;
+            gen += 2;
+            oracle_target(build, t, dist, stamp, gen, queue);
+        }
+    }
+    free(dist);
+    free(stamp);
+    if (queue) free_queue(queue);
+    return NULL;
+}
+
+// Run one backward search per target, spread over threads workers
+Oracle *build_oracle(Graph *graph, Engine engine, int threads) {
+    if (graph_build_reverse(graph) != 0) return NULL;
+    int V = graph->V;
+    int N = graph->N;
+
+    Oracle *oracle = calloc(1, sizeof(Oracle));
+    int64_t *rev_edge = malloc((graph->E ? graph->E : 1) * sizeof(int64_t));
+    int64_t *fill = malloc(((size_t)V + 1) * sizeof(int64_t));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    if (oracle) {
+        oracle->V = V;
+        oracle->N = N;
+        oracle->rank_bytes = rank_width(graph);
+        oracle->next = malloc((size_t)V * V * N * oracle->rank_bytes);
+    }
+    if (!oracle || !oracle->next || !rev_edge || !fill || !ids) {
+        fprintf(stderr, "Out of memory building oracle\n");
+        if (oracle) free_oracle(oracle);
+        free(rev_edge);
+        free(fill);
+        free(ids);
+        return NULL;
+    }
+    memset(oracle->next, 0xff, (size_t)V * V * N * oracle->rank_bytes);
+
+    // Reverse slots are filled in forward edge order, as in graph_build_reverse()
+    memcpy(fill, graph->rev_offsets, ((size_t)V + 1) * sizeof(int64_t));
+    for (int u = 0; u < V; u++) {
+        for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            rev_edge[fill[graph->targets[e]]++] = e;
+        }
+    }
+    free(fill);
+
+    OracleBuild build = {0};
+    build.oracle = oracle;
+    build.graph = graph;
+    build.rev_edge = rev_edge;
+    build.engine = engine;
+    pthread_mutex_init(&build.lock, NULL);
+
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&ids[i], NULL, oracle_worker, &build) != 0) break;
+        started = i;
+    }
+    oracle_worker(&build);
+    for (int i = 1; i <= started; i++) pthread_join(ids[i], NULL);
+    pthread_mutex_destroy(&build.lock);
+    free(ids);
+    free(rev_edge);
+
+    if (build.failed) {
+        fprintf(stderr, "Out of memory building oracle\n");
+        free_oracle(oracle);
+        return NULL;
+    }
+    oracle->fingerprint = graph_fingerprint(graph);
+    return oracle;
+}
+
+int save_oracle(const Oracle *oracle, const Graph *graph, const char *path) {
+    OracleHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ORACLE_MAGIC, sizeof(ORACLE_MAGIC));
+    header.version = ORACLE_VERSION;
+    header.rank_bytes = oracle->rank_bytes;
+    header.V = oracle->V;
+    header.N = oracle->N;
+    header.E = graph->E;
+    header.fingerprint = oracle->fingerprint;
+    size_t next_bytes = (size_t)oracle->V * oracle->V * oracle->N * oracle->rank_bytes;
+    header.next_at = align_up(sizeof(header), ORACLE_ALIGN);
+    header.file_size = header.next_at + next_bytes;
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        perror("Error creating oracle file");
+        return -1;
+    }
+    static const char zeros[ORACLE_ALIGN];
+    int status = 0;
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(zeros, 1, header.next_at - sizeof(header), file) != header.next_at - sizeof(header) ||
+        fwrite(oracle->next, 1, next_bytes, file) != next_bytes) {
+        status = -1;
+    }
+    if (fclose(file) != 0) status = -1;
+    if (status != 0) fprintf(stderr, "Error writing oracle %s\n", path);
+    return status;
+}
+
+// Map a saved oracle; returns NULL (quietly if the file is missing) when
+// it does not exist or was built for a different graph
+Oracle *load_oracle(const Graph *graph, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(OracleHeader)) {
+        close(fd);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return NULL;
+
+    const OracleHeader *header = mapping;
+    if (memcmp(header->magic, ORACLE_MAGIC, sizeof(ORACLE_MAGIC)) != 0 ||
+        header->version != ORACLE_VERSION || header->V != graph->V || header->N != graph->N ||
+        header->E != graph->E || header->rank_bytes != (uint32_t)rank_width(graph) ||
+        header->file_size != (uint64_t)st.st_size ||
+        header->fingerprint != graph_fingerprint(graph)) {
+        fprintf(stderr, "Oracle %s does not match this graph; rebuilding\n", path);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+
+    Oracle *oracle = calloc(1, sizeof(Oracle));
+    if (!oracle) {
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    oracle->V = header->V;
+    oracle->N = header->N;
+    oracle->rank_bytes = header->rank_bytes;
+    oracle->fingerprint = header->fingerprint;
+    oracle->next = (char *)mapping + header->next_at;
+    oracle->mapping = mapping;
+    oracle->mapping_size = st.st_size;
+    return oracle;
+}
+
+void free_oracle(Oracle *oracle) {
+    if (oracle->mapping) {
+        munmap(oracle->mapping, oracle->mapping_size);
+    } else {
+        free(oracle->next);
+    }
+    free(oracle);
+}
+
+// Walk the next-hop table from (start, phase) to end
+int *oracle_path(const Oracle *oracle, const Graph *graph, int start, int phase, int end, int *path_len) {
+    int V = oracle->V;
+    int N = oracle->N;
+    size_t row = (size_t)end * V * N;
+    uint32_t none = no_rank(oracle);
+
+    *path_len = 0;
+    int len = 1;
+    for (int at = start, p = phase; at != end; p = (p + 1) % N) {
+        uint32_t rank = get_rank(oracle, row + (size_t)at * N + p);
+        if (rank == none) return NULL;
+        at = graph->targets[graph->offsets[at] + rank];
+        len++;
+    }
+
+    int *path = malloc(len * sizeof(int));
+    if (!path) return NULL;
+    path[0] = start;
+    for (int at = start, p = phase, i = 1; at != end; p = (p + 1) % N) {
+        at = graph->targets[graph->offsets[at] + get_rank(oracle, row + (size_t)at * N + p)];
+        path[i++] = at;
+    }
+    *path_len = len;
+    return path;
+}
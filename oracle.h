@@ -0,0 +1,52 @@
+#ifndef ORACLE_H
+#define ORACLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "a8.h"
+#include "graph.h"
+#include "queue.h"
+
+#define ORACLE_MAGIC "A8ORACL"
+#define ORACLE_VERSION 2
+
+// Precomputed answers for every (source, target) pair
+//
+// Built from one backward search per target t, started at every phase of
+// t. The next-hop table holds, for each target and each state (v, p), the rank of the out-edge
+// of v that starts an optimal continuation to t; the next phase is
+// always p + 1, so it is not stored. Ranks take 1, 2 or 4 bytes depending
+// on the largest out-degree, with the all-ones value meaning "none", so
+// an unreachable pair is known from the first lookup.
+typedef struct Oracle {
+    int V;
+    int N;
+    int rank_bytes;
+    void *next;          // V * (V * N) ranks, row t for target t
+    uint64_t fingerprint;
+
+    void *mapping;       // File backing next when loaded
+    size_t mapping_size;
+} Oracle;
+
+// On-disk header; next follows, 64-byte aligned
+typedef struct OracleHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t rank_bytes;
+    int32_t V;
+    int32_t N;
+    int64_t E;
+    uint64_t fingerprint;
+    uint64_t next_at;
+    uint64_t file_size;
+} OracleHeader;
+
+size_t oracle_bytes(const Graph *graph);
+Oracle *build_oracle(Graph *graph, Engine engine, int threads);
+int save_oracle(const Oracle *oracle, const Graph *graph, const char *path);
+Oracle *load_oracle(const Graph *graph, const char *path);
+void free_oracle(Oracle *oracle);
+int *oracle_path(const Oracle *oracle, const Graph *graph, int start, int phase, int end, int *path_len);
+
+#endif // ORACLE_H
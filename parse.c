@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "parse.h"
+
+// Smallest chunk worth handing to its own thread
+#define PARSE_MIN_CHUNK (1 << 20)
+
+// Edges parsed from one chunk, in file order
+typedef struct ParseChunk {
+    const TextGraph *text;
+    const char *begin;
+    const char *end;
+
+    int *sources;
+    int *targets;
+    int *weights;        // N per edge, record-major
+    size_t count;
+    size_t capacity;
+
+    size_t lines;        // Lines in the chunk
+    size_t error_line;   // 1-based line within the chunk, 0 if none
+    const char *error;
+} ParseChunk;
+
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parse one decimal int at *p, stopping at end; advances *p past it
+static inline bool parse_int(const char **p, const char *end, int *out) {
+    const char *s = *p;
+    while (s < end && is_blank(*s)) s++;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        s++;
+    }
+    if (s == end || (unsigned)(*s - '0') > 9) return false;
+    long long value = 0;
+    while (s < end && (unsigned)(*s - '0') <= 9) {
+        value = value * 10 + (*s - '0');
+        if (value > (long long)INT_MAX + 1) return false;
+        s++;
+    }
+    if (negative) value = -value;
+    if (value > INT_MAX || value < INT_MIN) return false;
+    *out = (int)value;
+    *p = s;
+    return true;
+}
+
+static bool chunk_reserve(ParseChunk *chunk, int N) {
+    if (chunk->count < chunk->capacity) return true;
+    size_t capacity = chunk->capacity ? chunk->capacity * 2 : 4096;
+    int *sources = realloc(chunk->sources, capacity * sizeof(int));
+    if (sources) chunk->sources = sources;
+    int *targets = realloc(chunk->targets, capacity * sizeof(int));
+    if (targets) chunk->targets = targets;
+    int *weights = realloc(chunk->weights, capacity * N * sizeof(int));
+    if (weights) chunk->weights = weights;
+    if (!sources || !targets || !weights) return false;
+    chunk->capacity = capacity;
+    return true;
+}
+
+// Parse every "src dest w0 .. wN-1" line of a chunk
+static void *parse_chunk(void *arg) {
+    ParseChunk *chunk = arg;
+    int V = chunk->text->V;
+    int N = chunk->text->N;
+    const char *p = chunk->begin;
+
+    while (p < chunk->end) {
+        const char *eol = memchr(p, '\n', chunk->end - p);
+        if (!eol) eol = chunk->end;
+        chunk->lines++;
+
+        const char *s = p;
+        while (s < eol && is_blank(*s)) s++;
+        if (s < eol) {
+            if (!chunk_reserve(chunk, N)) {
+                chunk->error = "out of memory";
+                chunk->error_line = chunk->lines;
+                return NULL;
+            }
+            int src, dest;
+            int *weights = chunk->weights + chunk->count * N;
+            if (!parse_int(&s, eol, &src) || !parse_int(&s, eol, &dest)) {
+                chunk->error = "expected source and target vertex";
+            } else if (src < 0 || src >= V || dest < 0 || dest >= V) {
+                chunk->error = "vertex out of range";
+            } else {
+                for (int i = 0; i < N; i++) {
+                    if (!parse_int(&s, eol, &weights[i])) {
+                        chunk->error = "expected one weight per phase";
+                        break;
+                    }
+                }
+                while (!chunk->error && s < eol && is_blank(*s)) s++;
+                if (!chunk->error && s < eol) chunk->error = "unexpected data after weights";
+            }
+            if (chunk->error) {
+                chunk->error_line = chunk->lines;
+                return NULL;
+            }
+            chunk->sources[chunk->count] = src;
+            chunk->targets[chunk->count] = dest;
+            chunk->count++;
+        }
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+// Map path and read its "V N" header
+TextGraph *open_text_graph(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening file");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Error opening file");
+        close(fd);
+        return NULL;
+    }
+
+    TextGraph *text = calloc(1, sizeof(TextGraph));
+    if (!text) {
+        close(fd);
+        return NULL;
+    }
+    text->size = st.st_size;
+    if (text->size) {
+        void *data = mmap(NULL, text->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("Error mapping file");
+            close(fd);
+            free(text);
+            return NULL;
+        }
+        madvise(data, text->size, MADV_SEQUENTIAL);
+        text->data = data;
+    }
+    close(fd);
+
+    const char *p = text->data;
+    const char *end = text->data + text->size;
+    while (p < end && (is_blank(*p) || *p == '\n')) p++;
+    const char *eol = p < end ? memchr(p, '\n', end - p) : NULL;
+    if (!eol) eol = end;
+    if (!parse_int(&p, eol, &text->V) || !parse_int(&p, eol, &text->N) ||
+        text->V <= 0 || text->N <= 0) {
+        fprintf(stderr, "Invalid input format\n");
+        close_text_graph(text);
+        return NULL;
+    }
+    text->body = eol < end ? eol + 1 - text->data : text->size;
+    return text;
+}
+
+void close_text_graph(TextGraph *text) {
+    if (text->data) munmap((void *)text->data, text->size);
+    free(text);
+}
+
+// Parse the edge lines on up to threads threads and build the CSR graph.
+// Chunks split at line boundaries; each thread parses its own chunk into
+// flat arrays, which are then scattered into rows. Within a row edges are
+// stored in reverse file order, matching the original adjacency lists.
+Graph *parse_text_graph(TextGraph *text, int threads) {
+    int V = text->V;
+    int N = text->N;
+    size_t body = text->size - text->body;
+    if (threads < 1) threads = 1;
+    if ((size_t)threads > body / PARSE_MIN_CHUNK + 1) threads = body / PARSE_MIN_CHUNK + 1;
+
+    ParseChunk *chunks = calloc(threads, sizeof(ParseChunk));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    Graph *graph = create_graph(V, N);
+    if (!chunks || !ids || !graph) {
+        fprintf(stderr, "Out of memory parsing graph\n");
+        free(chunks);
+        free(ids);
+        if (graph) free_graph(graph);
+        return NULL;
+    }
+
+    const char *p = text->data + text->body;
+    const char *end = text->data + text->size;
+    for (int i = 0; i < threads; i++) {
+        const char *stop = i == threads - 1 ? end : p + (end - p) / (threads - i);
+        if (stop < end) {
+            const char *eol = memchr(stop, '\n', end - stop);
+            stop = eol ? eol + 1 : end;
+        }
+        chunks[i].text = text;
+        chunks[i].begin = p;
+        chunks[i].end = stop;
+        p = stop;
+    }
+
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&ids[i], NULL, parse_chunk, &chunks[i]) != 0) break;
+        started = i;
+    }
+    parse_chunk(&chunks[0]);
+    for (int i = started + 1; i < threads; i++) parse_chunk(&chunks[i]);
+    for (int i = 1; i <= started; i++) pthread_join(ids[i], NULL);
+
+    // Report the first malformed record by its line in the whole file
+    size_t line = 1;
+    for (const char *s = text->data; s < text->data + text->body; s++) line += *s == '\n';
+    int status = 0;
+    int64_t E = 0;
+    for (int i = 0; i < threads; i++) {
+        if (chunks[i].error) {
+            fprintf(stderr, "Line %zu: %s\n", line + chunks[i].error_line - 1, chunks[i].error);
+            status = -1;
+            break;
+        }
+        line += chunks[i].lines;
+        E += chunks[i].count;
+    }
+
+    if (status == 0) {
+        size_t nweights = (size_t)N * E;
+        graph->E = E;
+        graph->offsets = calloc((size_t)V + 1, sizeof(int64_t));
+        graph->targets = malloc((E ? E : 1) * sizeof(int));
+        graph->weights = malloc((nweights ? nweights : 1) * sizeof(int));
+        if (!graph->offsets || !graph->targets || !graph->weights) {
+            fprintf(stderr, "Out of memory building CSR graph\n");
+            status = -1;
+        }
+    }
+
+    if (status == 0) {
+        int64_t *offsets = graph->offsets;
+        for (int i = 0; i < threads; i++) {
+            for (size_t k = 0; k < chunks[i].count; k++) offsets[chunks[i].sources[k] + 1]++;
+        }
+        for (int v = 0; v < V; v++) offsets[v + 1] += offsets[v];
+
+        // Fill each row from its end, walking the file forwards
+        int64_t *fill = malloc((size_t)V * sizeof(int64_t));
+        if (!fill) {
+            fprintf(stderr, "Out of memory building CSR graph\n");
+            status = -1;
+        } else {
+            memcpy(fill, offsets + 1, (size_t)V * sizeof(int64_t));
+            int min_weight = INT_MAX;
+            int max_weight = INT_MIN;
+            for (int i = 0; i < threads; i++) {
+                const ParseChunk *chunk = &chunks[i];
+                for (size_t k = 0; k < chunk->count; k++) {
+                    int64_t e = --fill[chunk->sources[k]];
+                    graph->targets[e] = chunk->targets[k];
+                    const int *w = chunk->weights + k * N;
+                    for (int phase = 0; phase < N; phase++) {
+                        graph->weights[(size_t)phase * E + e] = w[phase];
+                        if (w[phase] < min_weight) min_weight = w[phase];
+                        if (w[phase] > max_weight) max_weight = w[phase];
+                    }
+                }
+            }
+            graph->min_weight = E ? min_weight : 0;
+            graph->max_weight = E ? max_weight : 0;
+            free(fill);
+        }
+    }
+
+    for (int i = 0; i < threads; i++) {
+        free(chunks[i].sources);
+        free(chunks[i].targets);
+        free(chunks[i].weights);
+    }
+    free(chunks);
+    free(ids);
+    if (status != 0) {
+        free_graph(graph);
+        return NULL;
+    }
+    return graph;
+}
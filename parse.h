@@ -0,0 +1,20 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stddef.h>
+#include "graph.h"
+
+// A graph.txt file mapped for parsing, with its "V N" header already read
+typedef struct TextGraph {
+    const char *data;
+    size_t size;
+    size_t body;         // Offset of the first edge line
+    int V;
+    int N;
+} TextGraph;
+
+TextGraph *open_text_graph(const char *path);
+Graph *parse_text_graph(TextGraph *text, int threads);
+void close_text_graph(TextGraph *text);
+
+#endif // PARSE_H
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perf.h"
+
+const char *const counter_names[COUNTER_KINDS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "task_clock_ns"
+};
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} events[COUNTER_KINDS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+};
+
+// Workers open their counters independently; only the first reports
+static int reported;
+
+static int open_event(int k) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[k].type;
+    attr.config = events[k].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Calling thread, any CPU, no group
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Open every event for the calling thread. Returns NULL, after one
+// warning per process, when none of them can be opened.
+PerfCounters *open_perf_counters(void) {
+    PerfCounters *perf = calloc(1, sizeof(PerfCounters));
+    if (!perf) return NULL;
+    int opened = 0;
+    int first_error = 0;
+    char missing[128] = "";
+    for (int k = 0; k < COUNTER_KINDS; k++) {
+        perf->fd[k] = open_event(k);
+        if (perf->fd[k] >= 0) {
+            opened++;
+            continue;
+        }
+        if (!first_error) first_error = errno;
+        size_t used = strlen(missing);
+        snprintf(missing + used, sizeof(missing) - used, "%s%s", used ? ", " : "", counter_names[k]);
+    }
+
+    bool first = __atomic_exchange_n(&reported, 1, __ATOMIC_RELAXED) == 0;
+    if (!opened) {
+        if (first) {
+            fprintf(stderr, "perf_event_open: %s; running without hardware counters\n",
+                    strerror(first_error));
+        }
+        free(perf);
+        return NULL;
+    }
+    if (first && missing[0]) {
+        fprintf(stderr, "perf_event_open: %s for %s; leaving them out\n",
+                strerror(first_error), missing);
+    }
+    return perf;
+}
+
+static bool read_event(int fd, uint64_t value[3]) {
+    return read(fd, value, 3 * sizeof(uint64_t)) == 3 * sizeof(uint64_t);
+}
+
+void perf_begin(PerfCounters *perf) {
+    for (int k = 0; k < COUNTER_KINDS; k++) {
+        if (perf->fd[k] >= 0 && !read_event(perf->fd[k], perf->before[k])) {
+            memset(perf->before[k], 0, sizeof(perf->before[k]));
+        }
+    }
+}
+
+// Store the counts since perf_begin() in stats
+void perf_end(PerfCounters *perf, SearchStats *stats) {
+    stats->counted = 0;
+    for (int k = 0; k < COUNTER_KINDS; k++) {
+        uint64_t after[3];
+        stats->counters[k] = 0;
+        if (perf->fd[k] < 0 || !read_event(perf->fd[k], after)) continue;
+        uint64_t value = after[0] - perf->before[k][0];
+        uint64_t enabled = after[1] - perf->before[k][1];
+        uint64_t running = after[2] - perf->before[k][2];
+        // Multiplexed: the event only counted for part of the interval
+        if (running > 0 && running < enabled) value = (uint64_t)((double)value * enabled / running);
+        stats->counters[k] = value;
+        stats->counted |= 1u << k;
+    }
+}
+
+void close_perf_counters(PerfCounters *perf) {
+    for (int k = 0; k < COUNTER_KINDS; k++) {
+        if (perf->fd[k] >= 0) close(perf->fd[k]);
+    }
+    free(perf);
+}
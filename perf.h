@@ -0,0 +1,26 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include "stats.h"
+
+// Per-thread hardware counters from perf_event_open(2)
+//
+// Each event is opened on its own for the calling thread, user space
+// only, so an event the CPU or the kernel refuses is simply left out.
+// Counting runs from open to close; a search reads every counter before
+// and after and keeps the differences, scaled up when the kernel had to
+// multiplex the events.
+typedef struct PerfCounters {
+    int fd[COUNTER_KINDS];           // -1 when the event is unavailable
+    uint64_t before[COUNTER_KINDS][3];   // value, time enabled, time running
+} PerfCounters;
+
+extern const char *const counter_names[COUNTER_KINDS];
+
+PerfCounters *open_perf_counters(void);
+void perf_begin(PerfCounters *perf);
+void perf_end(PerfCounters *perf, SearchStats *stats);
+void close_perf_counters(PerfCounters *perf);
+
+#endif // PERF_H
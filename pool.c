@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pool.h"
+
+typedef struct WorkerArgs {
+    Pool *pool;
+    Workspace *ws;
+} WorkerArgs;
+
+// Worker loop: take the next streaming job, batch group or matrix row,
+// answer it with this worker's workspace, and report completion
+static void *worker_main(void *arg) {
+    WorkerArgs *args = arg;
+    Pool *pool = args->pool;
+    Workspace *ws = args->ws;
+    free(args);
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        if (pool->claimed < pool->tail) {
+            size_t slot = pool->claimed++ % POOL_RING_SIZE;
+            pthread_mutex_unlock(&pool->lock);
+            answer_query(ws, &pool->ring[slot]);
+            pthread_mutex_lock(&pool->lock);
+            pool->done[slot] = true;
+            pthread_cond_signal(&pool->work_done);
+        } else if (pool->groups && pool->next_group < pool->groups->count) {
+            size_t g = pool->next_group++;
+            pthread_mutex_unlock(&pool->lock);
+            answer_group(ws, pool->batch, pool->groups, g);
+            pthread_mutex_lock(&pool->lock);
+            if (++pool->groups_done == pool->groups->count) {
+                pthread_cond_signal(&pool->work_done);
+            }
+        } else if (pool->matrix && pool->next_row < pool->matrix->rows) {
+            int row = pool->next_row++;
+            pthread_mutex_unlock(&pool->lock);
+            answer_matrix_row(ws, pool->matrix, row);
+            pthread_mutex_lock(&pool->lock);
+            if (++pool->rows_done == pool->matrix->rows) {
+                pthread_cond_signal(&pool->work_done);
+            }
+        } else if (pool->shutdown) {
+            break;
+        } else {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Function to create a pool of nthreads workers, each with a workspace
+Pool *create_pool(const Graph *graph, const SearchConfig *config, int nthreads) {
+    Pool *pool = calloc(1, sizeof(Pool));
+    if (!pool) return NULL;
+    pool->graph = graph;
+    pool->threads = calloc(nthreads, sizeof(pthread_t));
+    pool->workspaces = calloc(nthreads, sizeof(Workspace *));
+    pool->ring = calloc(POOL_RING_SIZE, sizeof(Query));
+    pool->done = calloc(POOL_RING_SIZE, sizeof(bool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    if (!pool->threads || !pool->workspaces || !pool->ring || !pool->done) {
+        free_pool(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < nthreads; i++) {
+        Workspace *ws = create_workspace(graph, config);
+        WorkerArgs *args = malloc(sizeof(WorkerArgs));
+        if (ws && args) {
+            args->pool = pool;
+            args->ws = ws;
+        }
+        if (!ws || !args || pthread_create(&pool->threads[i], NULL, worker_main, args) != 0) {
+            if (ws) free_workspace(ws);
+            free(args);
+            free_pool(pool);
+            return NULL;
+        }
+        pool->workspaces[i] = ws;
+        pool->nthreads++;
+    }
+    return pool;
+}
+
+// Print the finished jobs at the head of the ring. Called with the lock
+// held; the lock is dropped while printing since workers never touch
+// finished slots and the reader only reuses slots behind head.
+static void drain_finished(Pool *pool, FILE *out, StatsLog *log) {
+    size_t first = pool->head;
+    size_t last = first;
+    while (last < pool->tail && pool->done[last % POOL_RING_SIZE]) last++;
+    if (last == first) return;
+
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = first; i < last; i++) {
+        Query *query = &pool->ring[i % POOL_RING_SIZE];
+        print_answer(out, query);
+        if (log) log_query_stats(log, query);
+        release_answers(query, 1);
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->head = last;
+}
+
+// Hand one query to the workers and print whatever finished meanwhile.
+// Blocks only while the ring is full.
+void pool_submit(Pool *pool, const Query *query, FILE *out, StatsLog *log) {
+    pthread_mutex_lock(&pool->lock);
+    // Wait for the oldest job when the ring is full
+    while (pool->tail - pool->head == POOL_RING_SIZE) {
+        drain_finished(pool, out, log);
+        if (pool->tail - pool->head == POOL_RING_SIZE) {
+            pthread_cond_wait(&pool->work_done, &pool->lock);
+        }
+    }
+
+    size_t slot = pool->tail % POOL_RING_SIZE;
+    pool->ring[slot] = *query;
+    pool->done[slot] = false;
+    pool->tail++;
+    pthread_cond_signal(&pool->work_ready);
+    drain_finished(pool, out, log);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Wait for every submitted query and print the remaining answers
+void pool_finish(Pool *pool, FILE *out, StatsLog *log) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->head < pool->tail) {
+        drain_finished(pool, out, log);
+        if (pool->head < pool->tail) {
+            pthread_cond_wait(&pool->work_done, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Stream queries from in to the workers and print answers in input
+// order, logging their statistics to log when it is set
+void pool_stream(Pool *pool, FILE *in, FILE *out, StatsLog *log) {
+    Query query;
+    while (read_queries(in, &query, 1) == 1) pool_submit(pool, &query, out, log);
+    pool_finish(pool, out, log);
+}
+
+// Answer a window of queries grouped by start, spreading the groups over
+// the workers; returns once every group is answered
+void pool_answer_batch(Pool *pool, Query *queries, size_t count) {
+    SourceGroups groups;
+    if (group_by_source(pool->graph->V, pool->graph->N, queries, count, &groups) != 0) {
+        answer_batch(pool->workspaces[0], queries, count);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->batch = queries;
+    pool->groups = &groups;
+    pool->next_group = 0;
+    pool->groups_done = 0;
+    pthread_cond_broadcast(&pool->work_ready);
+    while (pool->groups_done < groups.count) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pool->groups = NULL;
+    pool->batch = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    free_groups(&groups);
+}
+
+// Fill a matrix with the workers claiming its rows in turn; returns once
+// every row is answered
+void pool_answer_matrix(Pool *pool, Matrix *matrix) {
+    pthread_mutex_lock(&pool->lock);
+    pool->matrix = matrix;
+    pool->next_row = 0;
+    pool->rows_done = 0;
+    pthread_cond_broadcast(&pool->work_ready);
+    while (pool->rows_done < matrix->rows) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pool->matrix = NULL;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void free_pool(Pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nthreads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    for (int i = 0; i < pool->nthreads; i++) {
+        free_workspace(pool->workspaces[i]);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->workspaces);
+    free(pool->ring);
+    free(pool->done);
+    free(pool);
+}
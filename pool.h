@@ -0,0 +1,62 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "graph.h"
+#include "queue.h"
+#include "query.h"
+#include "matrix.h"
+
+// Queries in flight between the reader and the workers in streaming mode
+#define POOL_RING_SIZE 4096
+
+// Fixed set of worker threads sharing one read-only graph
+//
+// Each worker owns a Workspace. In streaming mode the main thread appends
+// queries to a ring, workers claim them in order, and the main thread
+// prints finished slots from the head so output keeps input order. In
+// batch mode the workers claim whole source groups of a window, and in
+// matrix mode one row at a time.
+typedef struct Pool {
+    const Graph *graph;
+    int nthreads;
+    pthread_t *threads;
+    Workspace **workspaces;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;   // Signalled when jobs are added
+    pthread_cond_t work_done;    // Signalled when a job finishes
+    bool shutdown;
+
+    // Streaming ring: jobs head .. tail - 1 are unprinted, claimed .. tail - 1
+    // are not yet taken by a worker
+    Query *ring;
+    bool *done;
+    size_t head;
+    size_t claimed;
+    size_t tail;
+
+    // Current batch window
+    Query *batch;
+    const SourceGroups *groups;
+    size_t next_group;
+    size_t groups_done;
+
+    // Current distance matrix
+    Matrix *matrix;
+    int next_row;
+    int rows_done;
+} Pool;
+
+Pool *create_pool(const Graph *graph, const SearchConfig *config, int nthreads);
+void pool_submit(Pool *pool, const Query *query, FILE *out, StatsLog *log);
+void pool_finish(Pool *pool, FILE *out, StatsLog *log);
+void pool_stream(Pool *pool, FILE *in, FILE *out, StatsLog *log);
+void pool_answer_batch(Pool *pool, Query *queries, size_t count);
+void pool_answer_matrix(Pool *pool, Matrix *matrix);
+void free_pool(Pool *pool);
+
+#endif // POOL_H
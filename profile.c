@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "profile.h"
+
+// Profile with every phase unanswered
+Profile *create_profile(int N) {
+    Profile *profile = calloc(1, sizeof(Profile));
+    if (!profile) return NULL;
+    profile->N = N;
+    profile->cost = malloc(N * sizeof(int));
+    profile->path = calloc(N, sizeof(int *));
+    profile->path_len = calloc(N, sizeof(int));
+    if (!profile->cost || !profile->path || !profile->path_len) {
+        free_profile(profile);
+        return NULL;
+    }
+    for (int k = 0; k < N; k++) profile->cost[k] = INF;
+    return profile;
+}
+
+// Walk departure k's predecessors back from (end, step)
+static int *profile_path(const Workspace *ws, int end, int step, int k, int *path_len) {
+    int N = ws->graph->N;
+    int len = 0;
+    for (int at = end, p = step; at != -1; p = (p - 1 + N) % N) {
+        len++;
+        at = ws->pprev[((size_t)at * N + p) * N + k];
+    }
+    int *path = malloc(len * sizeof(int));
+    if (!path) return NULL;
+    *path_len = len;
+    for (int at = end, p = step; at != -1; p = (p - 1 + N) % N) {
+        path[--len] = at;
+        at = ws->pprev[((size_t)at * N + p) * N + k];
+    }
+    return path;
+}
+
+// Lower end's per-departure costs to the labels of state s of end, and
+// return the largest of them: nothing popped at or above it can help
+static int update_end(const Workspace *ws, Profile *profile, size_t s) {
+    int N = profile->N;
+    const int *labels = ws->pdist + s * N;
+    int bound = 0;
+    for (int k = 0; k < N; k++) {
+        if (labels[k] < profile->cost[k]) profile->cost[k] = labels[k];
+        if (profile->cost[k] > bound) bound = profile->cost[k];
+    }
+    return bound;
+}
+
+// One search for every departure phase of start. Each state carries N
+// costs, one per departure phase, and a state is queued whenever any of
+// them drops, keyed by the least that dropped. Every cost that drops
+// later is at least the key being popped, so keys still pop in order and
+// the search stops once the key reaches the dearest of end's costs.
+// Returns NULL when memory runs out.
+Profile *profile_search(Workspace *ws, int start, int end) {
+    const Graph *graph = ws->graph;
+    int N = graph->N;
+    int *pdist = ws->pdist;
+    int *pprev = ws->pprev;
+    uint32_t *stamp = ws->stamp;
+    Queue *queue = ws->queue;
+    ProfileRelaxFn relax = profile_relax_function(ws->config->kernel);
+    Profile *profile = create_profile(N);
+    if (!profile) return NULL;
+
+    // Labelled states have costs still to pass on; settled ones passed on
+    // all they have and are requeued when one drops again
+    begin_search(ws);
+    uint32_t labelled = ws->gen;
+    uint32_t settled = ws->gen + 1;
+    for (int k = 0; k < N; k++) {
+        size_t s = (size_t)start * N + k;
+        for (int j = 0; j < N; j++) {
+            pdist[s * N + j] = j == k ? 0 : INF;
+            pprev[s * N + j] = -1;
+        }
+        stamp[s] = labelled;
+        queue_push(queue, s, 0);
+        STAT_ADD(ws->stats, pushes, 1);
+    }
+    int bound = INF;
+    if (start == end) {
+        for (int k = 0; k < N; k++) bound = update_end(ws, profile, (size_t)start * N + k);
+    }
+
+    HeapEntry current;
+    while (pop_state(queue, &current) && current.key < bound) {
+        size_t s = current.state;
+        STAT_ADD(ws->stats, pops, 1);
+        // Bucket engines leave older copies of requeued states behind
+        if (stamp[s] == settled) {
+            STAT_ADD(ws->stats, stale_pops, 1);
+            continue;
+        }
+        stamp[s] = settled;
+        STAT_ADD(ws->stats, settled, 1);
+
+        int u = s / N;
+        int next_step = (s % N + 1) % N;
+        const int *labels = pdist + s * N;
+        const int *weights = graph->weights + (s % N) * graph->E;
+        int64_t first = graph->offsets[u];
+        int64_t last = graph->offsets[u + 1];
+        STAT_ADD(ws->stats, relaxations, last - first);
+        STAT_MAX(ws->stats, max_queue, queue_size(queue));
+        for (int64_t e = first; e < last; e++) {
+            int v = graph->targets[e];
+            size_t t = (size_t)v * N + next_step;
+            if (stamp[t] < labelled) {
+                for (int k = 0; k < N; k++) {
+                    pdist[t * N + k] = INF;
+                    pprev[t * N + k] = -1;
+                }
+            }
+            int key = relax(labels, weights[e], pdist + t * N, pprev + t * N, u, N);
+            if (key == INF) continue;
+            stamp[t] = labelled;
+            STAT_ADD(ws->stats, improvements, 1);
+            STAT_ADD(ws->stats, pushes, 1);
+            if (queue_push(queue, t, key) != 0) {
+                fprintf(stderr, "Out of memory growing queue\n");
+                exit(EXIT_FAILURE);
+            }
+            if (v == end) bound = update_end(ws, profile, t);
+        }
+    }
+
+    for (int k = 0; k < N; k++) {
+        if (profile->cost[k] == INF) continue;
+        // Arrive in the phase holding the cost
+        int step = 0;
+        while (pdist[((size_t)end * N + step) * N + k] != profile->cost[k] ||
+               stamp[(size_t)end * N + step] < labelled) {
+            step++;
+        }
+        profile->path[k] = profile_path(ws, end, step, k, &profile->path_len[k]);
+    }
+    return profile;
+}
+
+// One line per departure phase: "phase cost: path", or "phase: No path
+// found"
+void print_profile(FILE *out, const Profile *profile) {
+    for (int k = 0; k < profile->N; k++) {
+        if (!profile->path[k]) {
+            fprintf(out, "%d: No path found\n", k);
+            continue;
+        }
+        fprintf(out, "%d %d:", k, profile->cost[k]);
+        for (int i = 0; i < profile->path_len[k]; i++) fprintf(out, " %d", profile->path[k][i]);
+        fputc('\n', out);
+    }
+}
+
+void free_profile(Profile *profile) {
+    if (profile->path) {
+        for (int k = 0; k < profile->N; k++) free(profile->path[k]);
+    }
+    free(profile->cost);
+    free(profile->path);
+    free(profile->path_len);
+    free(profile);
+}
@@ -0,0 +1,20 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include "search.h"
+
+// Cheapest path from each departure phase of a query's start
+typedef struct Profile {
+    int N;
+    int *cost;           // Per departure phase, INF when end is unreachable
+    int **path;          // Per departure phase, NULL when unreachable
+    int *path_len;
+} Profile;
+
+Profile *create_profile(int N);
+Profile *profile_search(Workspace *ws, int start, int end);
+void print_profile(FILE *out, const Profile *profile);
+void free_profile(Profile *profile);
+
+#endif // PROFILE_H
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "query.h"
+#include "alt.h"
+#include "bidir.h"
+#include "oracle.h"
+#include "ch.h"
+#include "reach.h"
+#include "reorder.h"
+#include "perf.h"
+#include "update.h"
+#include "tree.h"
+#include "cache.h"
+#include "profile.h"
+
+// Fill query from a "start end" or "start end phase" line. Returns 0 on
+// success and -1 when the line holds no query.
+int parse_query(const char *line, Query *query) {
+    int consumed = 0;
+    if (sscanf(line, "%d %d%n", &query->start, &query->end, &consumed) != 2) return -1;
+    query->phase = 0;
+    int rest = 0;
+    if (sscanf(line + consumed, "%d%n", &query->phase, &rest) == 1) consumed += rest;
+    while (line[consumed] == ' ' || line[consumed] == '\t' || line[consumed] == '\r' ||
+           line[consumed] == '\n') {
+        consumed++;
+    }
+    if (line[consumed] != '\0') return -1;
+    query->path = NULL;
+    query->path_len = 0;
+    query->version = NULL;
+    query->profile = NULL;
+    memset(&query->stats, 0, sizeof(SearchStats));
+    return 0;
+}
+
+// Read up to max queries, one per line, stopping at the first line that
+// is not one; returns how many were read. A line holds exactly one query,
+// since a third number is its phase: "1 2 3 4" is not two queries.
+size_t read_queries(FILE *in, Query *queries, size_t max) {
+    char line[QUERY_LINE_MAX];
+    size_t count = 0;
+    while (count < max && fgets(line, sizeof(line), in)) {
+        if (line[strspn(line, " \t\r\n")] == '\0') continue;
+        if (parse_query(line, &queries[count]) != 0) {
+            line[strcspn(line, "\r\n")] = '\0';
+            fprintf(stderr, "Stopping at \"%s\": expected one \"start end [phase]\" query per line\n", line);
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+// Read the next window of queries into *queries, growing it as needed.
+// window == 0 reads the rest of the input. Returns how many were read.
+size_t read_window(FILE *in, Query **queries, size_t *capacity, size_t window) {
+    size_t count = 0;
+    for (;;) {
+        size_t want = window ? window : *capacity;
+        if (want > *capacity || !*queries) {
+            Query *grown = realloc(*queries, want * sizeof(Query));
+            if (!grown) return count;
+            *queries = grown;
+            *capacity = want;
+        }
+        count += read_queries(in, *queries + count, want - count);
+        if (count < want || window) return count;
+        // Whole buffer filled while reading everything: double and go on
+        Query *grown = realloc(*queries, *capacity * 2 * sizeof(Query));
+        if (!grown) return count;
+        *queries = grown;
+        *capacity *= 2;
+    }
+}
+
+static bool query_in_range(const Workspace *ws, const Query *query) {
+    int V = ws->graph->V;
+    return query->start >= 0 && query->start < V && query->end >= 0 && query->end < V &&
+           query->phase >= 0 && query->phase < ws->graph->N;
+}
+
+// Searches run on the graph's own ids; queries and printed paths keep
+// the ids of the input file
+static int inner_id(const Workspace *ws, int v) {
+    return ws->config->ordering ? ws->config->ordering->to_inner[v] : v;
+}
+
+static void restore_outer_ids(const Workspace *ws, Query *query) {
+    if (!ws->config->ordering) return;
+    const int *to_outer = ws->config->ordering->to_outer;
+    if (query->path) {
+        for (int i = 0; i < query->path_len; i++) query->path[i] = to_outer[query->path[i]];
+    }
+    for (int k = 0; query->profile && k < query->profile->N; k++) {
+        int *path = query->profile->path[k];
+        for (int i = 0; path && i < query->profile->path_len[k]; i++) path[i] = to_outer[path[i]];
+    }
+}
+
+// Start the counters of one search. Hardware counters count the calling
+// thread, so each workspace opens its own on the first search it runs.
+static void begin_counting(Workspace *ws) {
+    if (ws->config->perf && !ws->perf && !ws->perf_failed) {
+        ws->perf = open_perf_counters();
+        ws->perf_failed = !ws->perf;
+    }
+    stats_begin(&ws->stats);
+    if (ws->perf) perf_begin(ws->perf);
+}
+
+static void end_counting(Workspace *ws) {
+    if (ws->perf) perf_end(ws->perf, &ws->stats);
+    stats_end(&ws->stats);
+}
+
+// Answer a single query with its own search
+void answer_query(Workspace *ws, Query *query) {
+    query->path = NULL;
+    query->path_len = 0;
+    memset(&query->stats, 0, sizeof(SearchStats));
+    // Every version has the same vertices, so the workspace fits them all
+    const Reachability *reach = ws->config->reach;
+    if (query->version) {
+        ws->graph = &query->version->graph;
+        reach = query->version->topology->reach;
+    }
+    // Profile answers list every phase, even when none has a path
+    if (ws->config->profile) query->profile = create_profile(ws->graph->N);
+    if (!query_in_range(ws, query)) return;
+    int start = inner_id(ws, query->start);
+    int end = inner_id(ws, query->end);
+    if (reach && !may_reach(reach, start, end)) return;
+    int phase = query->phase;
+    // A hot source's tree answers without a search while it is current
+    if (query->version && ws->config->hot && phase == 0 &&
+        hot_tree_path(ws->config->hot, query->version, start, end, &query->path, &query->path_len)) {
+        restore_outer_ids(ws, query);
+        return;
+    }
+    begin_counting(ws);
+    if (ws->config->profile) {
+        Profile *profile = profile_search(ws, start, end);
+        if (profile) {
+            if (query->profile) free_profile(query->profile);
+            query->profile = profile;
+        }
+    } else if (ws->config->oracle) {
+        query->path = oracle_path(ws->config->oracle, ws->graph, start, phase, end, &query->path_len);
+    } else if (ws->config->hierarchy) {
+        query->path = ch_search(ws, start, phase, end, &query->path_len);
+    } else if (ws->config->landmarks) {
+        query->path = alt_search(ws, start, phase, end, &query->path_len);
+    } else if (ws->config->bidirectional) {
+        query->path = bidir_search(ws, start, phase, end, &query->path_len);
+    } else if (ws->config->cache && phase == 0) {
+        // Cached searches all depart in phase 0
+        query->path = cached_dijkstra(ws, ws->config->cache, start, end, &query->path_len);
+    } else {
+        query->path = dijkstra(ws, start, phase, end, &query->path_len);
+    }
+    end_counting(ws);
+    query->stats = ws->stats;
+    restore_outer_ids(ws, query);
+}
+
+static int compare_by_start(const void *a, const void *b) {
+    const SourceKey *x = a;
+    const SourceKey *y = b;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    if (x->phase != y->phase) return x->phase < y->phase ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+// Sort the in-range queries of a window by start and departure phase and
+// record where each run begins. Out-of-range queries are answered "no
+// path" here.
+int group_by_source(int V, int N, Query *queries, size_t count, SourceGroups *groups) {
+    groups->order = malloc((count ? count : 1) * sizeof(SourceKey));
+    groups->first = malloc((count + 1) * sizeof(size_t));
+    groups->count = 0;
+    if (!groups->order || !groups->first) {
+        free_groups(groups);
+        return -1;
+    }
+
+    size_t valid = 0;
+    for (size_t i = 0; i < count; i++) {
+        queries[i].path = NULL;
+        queries[i].path_len = 0;
+        memset(&queries[i].stats, 0, sizeof(SearchStats));
+        if (queries[i].start >= 0 && queries[i].start < V &&
+            queries[i].end >= 0 && queries[i].end < V &&
+            queries[i].phase >= 0 && queries[i].phase < N) {
+            groups->order[valid].start = queries[i].start;
+            groups->order[valid].phase = queries[i].phase;
+            groups->order[valid].index = i;
+            valid++;
+        }
+    }
+    qsort(groups->order, valid, sizeof(SourceKey), compare_by_start);
+
+    for (size_t k = 0; k < valid; k++) {
+        if (k == 0 || groups->order[k].start != groups->order[k - 1].start ||
+            groups->order[k].phase != groups->order[k - 1].phase) {
+            groups->first[groups->count++] = k;
+        }
+    }
+    groups->first[groups->count] = valid;
+    return 0;
+}
+
+void free_groups(SourceGroups *groups) {
+    free(groups->order);
+    free(groups->first);
+    groups->order = NULL;
+    groups->first = NULL;
+    groups->count = 0;
+}
+
+// Answer every query of group g with one search that stops once each end
+// requested from that start is settled
+void answer_group(Workspace *ws, Query *queries, const SourceGroups *groups, size_t g) {
+    size_t first = groups->first[g];
+    size_t last = groups->first[g + 1];
+    if (ws->config->oracle || ws->config->hierarchy ||
+        ws->config->landmarks || ws->config->bidirectional) {
+        // Table walks, goal-directed and preprocessed searches are per pair
+        for (size_t k = first; k < last; k++) answer_query(ws, &queries[groups->order[k].index]);
+        return;
+    }
+    int *targets = malloc((last - first) * sizeof(int));
+    if (!targets) {
+        for (size_t k = first; k < last; k++) answer_query(ws, &queries[groups->order[k].index]);
+        return;
+    }
+
+    // Unreachable ends would keep the search going until it runs dry
+    int start = inner_id(ws, groups->order[first].start);
+    int ntargets = 0;
+    for (size_t k = first; k < last; k++) {
+        int end = inner_id(ws, queries[groups->order[k].index].end);
+        if (!ws->config->reach || may_reach(ws->config->reach, start, end)) targets[ntargets++] = end;
+    }
+    if (ntargets > 0) {
+        begin_counting(ws);
+        search_targets(ws, start, groups->order[first].phase, targets, ntargets);
+        end_counting(ws);
+    }
+    for (size_t k = first; k < last; k++) {
+        Query *query = &queries[groups->order[k].index];
+        query->path = NULL;
+        query->path_len = 0;
+        // The group's one search is charged to its first query
+        memset(&query->stats, 0, sizeof(SearchStats));
+        if (k == first && ntargets > 0) query->stats = ws->stats;
+        // With no targets left the workspace still holds an older search
+        if (ntargets > 0) query->path = extract_path(ws, inner_id(ws, query->end), &query->path_len);
+        restore_outer_ids(ws, query);
+    }
+    free(targets);
+}
+
+// Answer a window of queries with one search per distinct start; the
+// answers are written back into the queries in their original slots
+void answer_batch(Workspace *ws, Query *queries, size_t count) {
+    SourceGroups groups;
+    if (group_by_source(ws->graph->V, ws->graph->N, queries, count, &groups) != 0) {
+        // Fall back to one search per query
+        for (size_t i = 0; i < count; i++) answer_query(ws, &queries[i]);
+        return;
+    }
+    for (size_t g = 0; g < groups.count; g++) {
+        answer_group(ws, queries, &groups, g);
+    }
+    free_groups(&groups);
+}
+
+void print_answer(FILE *out, const Query *query) {
+    if (query->profile) {
+        print_profile(out, query->profile);
+        return;
+    }
+    if (!query->path) {
+        fprintf(out, "No path found\n");
+        return;
+    }
+    for (int i = 0; i < query->path_len; i++) {
+        if (i > 0) fputc(' ', out);
+        fprintf(out, "%d", query->path[i]);
+    }
+    fputc('\n', out);
+}
+
+void release_answers(Query *queries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(queries[i].path);
+        queries[i].path = NULL;
+        if (queries[i].version) release_version(queries[i].version);
+        queries[i].version = NULL;
+        if (queries[i].profile) free_profile(queries[i].profile);
+        queries[i].profile = NULL;
+    }
+}
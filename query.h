@@ -0,0 +1,53 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "search.h"
+
+struct GraphVersion;
+struct Profile;
+
+// Longest query line read
+#define QUERY_LINE_MAX 256
+
+// One start/end request and its answer
+typedef struct Query {
+    int start;
+    int end;
+    int phase;           // Departure phase, 0 unless the line gives one
+    int *path;           // NULL when no path was found
+    int path_len;
+    SearchStats stats;   // Work done for this answer
+    struct GraphVersion *version;    // Graph to search when updates are on, else NULL
+    struct Profile *profile;         // Answers for every departure phase with --profile
+} Query;
+
+// Query position keyed by its start and departure phase, sorted so each
+// source forms a run
+typedef struct SourceKey {
+    int start;
+    int phase;
+    size_t index;
+} SourceKey;
+
+// Queries of a window grouped by start: group g is order[first[g]] up to
+// order[first[g + 1]] - 1
+typedef struct SourceGroups {
+    SourceKey *order;
+    size_t *first;
+    size_t count;
+} SourceGroups;
+
+int parse_query(const char *line, Query *query);
+size_t read_queries(FILE *in, Query *queries, size_t max);
+size_t read_window(FILE *in, Query **queries, size_t *capacity, size_t window);
+void answer_query(Workspace *ws, Query *query);
+int group_by_source(int V, int N, Query *queries, size_t count, SourceGroups *groups);
+void free_groups(SourceGroups *groups);
+void answer_group(Workspace *ws, Query *queries, const SourceGroups *groups, size_t g);
+void answer_batch(Workspace *ws, Query *queries, size_t count);
+void print_answer(FILE *out, const Query *query);
+void release_answers(Query *queries, size_t count);
+
+#endif // QUERY_H
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "queue.h"
+
+#define BUCKET_INITIAL_CAPACITY 16
+
+// Choose a queue engine for the graph's weight range. Bucket queues need
+// non-negative integer weights; Dial's also needs a small maximum.
+Engine select_engine(Engine requested, int min_weight, int max_weight) {
+    if (min_weight < 0) return ENGINE_HEAP;
+    if (requested == ENGINE_DIAL && max_weight > DIAL_MAX_WEIGHT) return ENGINE_RADIX;
+    if (requested != ENGINE_AUTO) return requested;
+    return max_weight <= DIAL_MAX_WEIGHT ? ENGINE_DIAL : ENGINE_RADIX;
+}
+
+const char *engine_name(Engine engine) {
+    switch (engine) {
+    case ENGINE_HEAP: return "heap";
+    case ENGINE_DIAL: return "dial";
+    case ENGINE_RADIX: return "radix";
+    default: return "auto";
+    }
+}
+
+// Append an entry to a bucket, growing it by doubling
+static int bucket_append(Bucket *bucket, uint32_t state, int key) {
+    if (bucket->size == bucket->capacity) {
+        size_t capacity = bucket->capacity ? bucket->capacity * 2 : BUCKET_INITIAL_CAPACITY;
+        HeapEntry *entries = realloc(bucket->entries, capacity * sizeof(HeapEntry));
+        if (!entries) return -1;
+        bucket->entries = entries;
+        bucket->capacity = capacity;
+    }
+    bucket->entries[bucket->size].key = key;
+    bucket->entries[bucket->size].state = state;
+    bucket->size++;
+    return 0;
+}
+
+int dial_push(DialQueue *dial, uint32_t state, int key) {
+    size_t idx = (size_t)key % dial->nbuckets;
+    // The scan position only moves forward from the last popped key, even
+    // when the queue runs empty, so it is set just once per search
+    if (dial->current == DIAL_UNSET) dial->current = idx;
+    if (bucket_append(&dial->buckets[idx], state, key) != 0) return -1;
+    dial->size++;
+    return 0;
+}
+
+int dial_pop(DialQueue *dial, HeapEntry *out) {
+    if (!dial->size) return 0;
+    Bucket *bucket = &dial->buckets[dial->current];
+    while (!bucket->size) {
+        if (++dial->current == dial->nbuckets) dial->current = 0;
+        bucket = &dial->buckets[dial->current];
+    }
+    *out = bucket->entries[--bucket->size];
+    dial->size--;
+    return 1;
+}
+
+// Bucket index of key relative to the last extracted key
+static inline int radix_index(unsigned key, unsigned last) {
+    unsigned diff = key ^ last;
+    return diff ? 32 - __builtin_clz(diff) : 0;
+}
+
+int radix_push(RadixHeap *radix, uint32_t state, int key) {
+    if (bucket_append(&radix->buckets[radix_index(key, radix->last)], state, key) != 0) return -1;
+    radix->size++;
+    return 0;
+}
+
+// Returns 1 with the minimum in out, 0 when empty, or -1 when refilling
+// bucket 0 runs out of memory. No entry is lost then, but their order is,
+// so the heap is only fit for clear_queue().
+int radix_pop(RadixHeap *radix, HeapEntry *out) {
+    if (!radix->size) return 0;
+    if (!radix->buckets[0].size) {
+        // Refill bucket 0 from the first non-empty bucket: its minimum
+        // becomes last and every entry moves to a strictly lower bucket
+        int i = 1;
+        while (!radix->buckets[i].size) i++;
+        Bucket *bucket = &radix->buckets[i];
+        unsigned min_key = (unsigned)bucket->entries[0].key;
+        for (size_t j = 1; j < bucket->size; j++) {
+            if ((unsigned)bucket->entries[j].key < min_key) {
+                min_key = (unsigned)bucket->entries[j].key;
+            }
+        }
+        radix->last = min_key;
+        while (bucket->size > 0) {
+            HeapEntry entry = bucket->entries[bucket->size - 1];
+            if (bucket_append(&radix->buckets[radix_index(entry.key, min_key)],
+                              entry.state, entry.key) != 0) {
+                return -1;
+            }
+            bucket->size--;
+        }
+    }
+    Bucket *bucket = &radix->buckets[0];
+    *out = bucket->entries[--bucket->size];
+    radix->size--;
+    return 1;
+}
+
+// Function to create a queue for the given engine (ENGINE_AUTO is not
+// accepted here; resolve it with select_engine() first)
+Queue *create_queue(Engine engine, size_t states, int max_weight) {
+    Queue *queue = calloc(1, sizeof(Queue));
+    if (!queue) return NULL;
+    queue->engine = engine;
+
+    switch (engine) {
+    case ENGINE_DIAL:
+        queue->dial = calloc(1, sizeof(DialQueue));
+        if (!queue->dial) break;
+        queue->dial->nbuckets = (size_t)(max_weight > 0 ? max_weight : 0) + 1;
+        queue->dial->current = DIAL_UNSET;
+        queue->dial->buckets = calloc(queue->dial->nbuckets, sizeof(Bucket));
+        if (queue->dial->buckets) return queue;
+        break;
+    case ENGINE_RADIX:
+        queue->radix = calloc(1, sizeof(RadixHeap));
+        if (queue->radix) return queue;
+        break;
+    default:
+        queue->engine = ENGINE_HEAP;
+        queue->heap = create_min_heap(states);
+        if (queue->heap) return queue;
+        break;
+    }
+    free_queue(queue);
+    return NULL;
+}
+
+// Empty the queue, keeping its storage for the next search
+void clear_queue(Queue *queue) {
+    if (queue->heap) clear_min_heap(queue->heap);
+    if (queue->dial) {
+        for (size_t i = 0; i < queue->dial->nbuckets; i++) {
+            queue->dial->buckets[i].size = 0;
+        }
+        queue->dial->size = 0;
+        queue->dial->current = DIAL_UNSET;
+    }
+    if (queue->radix) {
+        for (int i = 0; i < RADIX_BUCKETS; i++) {
+            queue->radix->buckets[i].size = 0;
+        }
+        queue->radix->size = 0;
+        queue->radix->last = 0;
+    }
+}
+
+void free_queue(Queue *queue) {
+    if (queue->heap) free_heap(queue->heap);
+    if (queue->dial) {
+        if (queue->dial->buckets) {
+            for (size_t i = 0; i < queue->dial->nbuckets; i++) {
+                free(queue->dial->buckets[i].entries);
+            }
+            free(queue->dial->buckets);
+        }
+        free(queue->dial);
+    }
+    if (queue->radix) {
+        for (int i = 0; i < RADIX_BUCKETS; i++) {
+            free(queue->radix->buckets[i].entries);
+        }
+        free(queue->radix);
+    }
+    free(queue);
+}
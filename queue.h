@@ -0,0 +1,96 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "heap.h"
+
+// Largest edge weight for which the circular bucket queue is used
+#define DIAL_MAX_WEIGHT 4096
+#define RADIX_BUCKETS 33
+#define DIAL_UNSET SIZE_MAX
+
+// Priority queue implementations a search can run on
+typedef enum Engine {
+    ENGINE_AUTO,         // Pick from the graph's weight range
+    ENGINE_HEAP,         // Indexed 4-ary heap with decrease-key
+    ENGINE_DIAL,         // Circular bucket queue (Dial's algorithm)
+    ENGINE_RADIX         // Radix heap for monotone integer keys
+} Engine;
+
+// Growable array of queue entries used as a bucket
+typedef struct Bucket {
+    HeapEntry *entries;
+    size_t size;
+    size_t capacity;
+} Bucket;
+
+// Dial's circular bucket queue: with weights in [0, C] every queued key lies
+// in [current, current + C], so key % (C + 1) picks a bucket holding only
+// that key. Improved states are pushed again and stale copies are skipped
+// by the search, which is cheaper than decrease-key here.
+typedef struct DialQueue {
+    Bucket *buckets;
+    size_t nbuckets;     // C + 1
+    size_t current;      // Bucket of the last popped key, or DIAL_UNSET
+    size_t size;
+} DialQueue;
+
+// Radix heap: entry with key k sits in bucket bitlength(k ^ last), where
+// last is the most recently extracted key. Keys must never drop below last.
+typedef struct RadixHeap {
+    Bucket buckets[RADIX_BUCKETS];
+    unsigned last;
+    size_t size;
+} RadixHeap;
+
+// Priority queue front end shared by the search engines
+typedef struct Queue {
+    Engine engine;
+    MinHeap *heap;
+    DialQueue *dial;
+    RadixHeap *radix;
+} Queue;
+
+Engine select_engine(Engine requested, int min_weight, int max_weight);
+const char *engine_name(Engine engine);
+Queue *create_queue(Engine engine, size_t states, int max_weight);
+void clear_queue(Queue *queue);
+void free_queue(Queue *queue);
+
+int dial_push(DialQueue *dial, uint32_t state, int key);
+int dial_pop(DialQueue *dial, HeapEntry *out);
+int radix_push(RadixHeap *radix, uint32_t state, int key);
+int radix_pop(RadixHeap *radix, HeapEntry *out);
+
+// Queue a state with the given key (decrease-key on the heap engine; the
+// bucket engines may hold stale copies, which pop after the live one)
+static inline int queue_push(Queue *queue, uint32_t state, int key) {
+    switch (queue->engine) {
+    case ENGINE_DIAL: return dial_push(queue->dial, state, key);
+    case ENGINE_RADIX: return radix_push(queue->radix, state, key);
+    default: return insert_or_decrease(queue->heap, state, key);
+    }
+}
+
+// Entries held, stale bucket copies included
+static inline size_t queue_size(const Queue *queue) {
+    switch (queue->engine) {
+    case ENGINE_DIAL: return queue->dial->size;
+    case ENGINE_RADIX: return queue->radix->size;
+    default: return queue->heap->size;
+    }
+}
+
+// Take the entry with the smallest key: 1 when there was one, 0 when the
+// queue is empty, -1 when the radix heap runs out of memory refilling
+static inline int queue_pop(Queue *queue, HeapEntry *out) {
+    switch (queue->engine) {
+    case ENGINE_DIAL: return dial_pop(queue->dial, out);
+    case ENGINE_RADIX: return radix_pop(queue->radix, out);
+    default: return extract_min(queue->heap, out) ? 1 : 0;
+    }
+}
+
+#endif // QUEUE_H
@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "reach.h"
+
+// Iterative Tarjan. Components complete sinks first, so the ids it hands
+// out already make every DAG edge point to a lower id.
+static int strong_components(const Graph *graph, int *component) {
+    int V = graph->V;
+    int *index = malloc(V * sizeof(int));
+    int *low = malloc(V * sizeof(int));
+    int *stack = malloc(V * sizeof(int));
+    int *calls = malloc(V * sizeof(int));
+    int64_t *next_edge = malloc(V * sizeof(int64_t));
+    if (!index || !low || !stack || !calls || !next_edge) {
+        free(index);
+        free(low);
+        free(stack);
+        free(calls);
+        free(next_edge);
+        return -1;
+    }
+    for (int v = 0; v < V; v++) {
+        index[v] = -1;
+        component[v] = -1;
+    }
+
+    int counter = 0;
+    int count = 0;
+    int depth = 0;
+    int top = 0;
+    for (int root = 0; root < V; root++) {
+        if (index[root] >= 0) continue;
+        index[root] = low[root] = counter++;
+        next_edge[root] = graph->offsets[root];
+        stack[top++] = root;
+        calls[depth++] = root;
+        while (depth > 0) {
+            int v = calls[depth - 1];
+            if (next_edge[v] < graph->offsets[v + 1]) {
+                int w = graph->targets[next_edge[v]++];
+                if (index[w] < 0) {
+                    index[w] = low[w] = counter++;
+                    next_edge[w] = graph->offsets[w];
+                    stack[top++] = w;
+                    calls[depth++] = w;
+                } else if (component[w] < 0 && index[w] < low[v]) {
+                    // w is still on the stack
+                    low[v] = index[w];
+                }
+                continue;
+            }
+            depth--;
+            if (depth > 0 && low[v] < low[calls[depth - 1]]) low[calls[depth - 1]] = low[v];
+            if (low[v] == index[v]) {
+                int w;
+                do {
+                    w = stack[--top];
+                    component[w] = count;
+                } while (w != v);
+                count++;
+            }
+        }
+    }
+    free(index);
+    free(low);
+    free(stack);
+    free(calls);
+    free(next_edge);
+    return count;
+}
+
+// Condensation edges, deduplicated per source component
+static int build_dag(Reachability *reach, const Graph *graph) {
+    int C = reach->components;
+    int *members = malloc(graph->V * sizeof(int));
+    int *first = calloc((size_t)C + 1, sizeof(int));
+    int *seen = malloc((C ? C : 1) * sizeof(int));
+    reach->dag_offsets = calloc((size_t)C + 1, sizeof(int64_t));
+    reach->dag_targets = malloc((graph->E ? graph->E : 1) * sizeof(int));
+    if (!members || !first || !seen || !reach->dag_offsets || !reach->dag_targets) {
+        free(members);
+        free(first);
+        free(seen);
+        return -1;
+    }
+
+    // Group the vertices by component
+    for (int v = 0; v < graph->V; v++) first[reach->component[v] + 1]++;
+    for (int c = 0; c < C; c++) first[c + 1] += first[c];
+    for (int v = 0; v < graph->V; v++) members[first[reach->component[v]]++] = v;
+    for (int c = C; c > 0; c--) first[c] = first[c - 1];
+    first[0] = 0;
+
+    for (int c = 0; c < C; c++) seen[c] = -1;
+    int64_t count = 0;
+    for (int c = 0; c < C; c++) {
+        reach->dag_offsets[c] = count;
+        for (int i = first[c]; i < first[c + 1]; i++) {
+            int u = members[i];
+            for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+                int d = reach->component[graph->targets[e]];
+                if (d == c || seen[d] == c) continue;
+                seen[d] = c;
+                reach->dag_targets[count++] = d;
+            }
+        }
+    }
+    reach->dag_offsets[C] = count;
+    free(members);
+    free(first);
+    free(seen);
+    return 0;
+}
+
+// Post-order ranks of REACH_INTERVALS DFS traversals with different child
+// orders; low is the smallest rank below a component
+static int label_intervals(Reachability *reach) {
+    int C = reach->components;
+    int *calls = malloc((C ? C : 1) * sizeof(int));
+    int64_t *next = malloc((C ? C : 1) * sizeof(int64_t));
+    if (!calls || !next) {
+        free(calls);
+        free(next);
+        return -1;
+    }
+    for (int k = 0; k < REACH_INTERVALS; k++) {
+        int *low = reach->low + (size_t)k * C;
+        int *post = reach->post + (size_t)k * C;
+        bool reverse = k % 2 == 1;
+        for (int c = 0; c < C; c++) post[c] = -1;
+        int rank = 0;
+        for (int i = 0; i < C; i++) {
+            // Sources have the highest ids
+            int root = reverse ? i : C - 1 - i;
+            if (post[root] >= 0) continue;
+            int depth = 0;
+            calls[depth++] = root;
+            next[root] = 0;
+            low[root] = INT_MAX;
+            post[root] = INT_MAX;   // Visited, rank pending
+            while (depth > 0) {
+                int c = calls[depth - 1];
+                int64_t begin = reach->dag_offsets[c];
+                int64_t degree = reach->dag_offsets[c + 1] - begin;
+                if (next[c] < degree) {
+                    int64_t at = next[c]++;
+                    int d = reach->dag_targets[reverse ? begin + degree - 1 - at : begin + at];
+                    if (post[d] < 0) {
+                        low[d] = INT_MAX;
+                        post[d] = INT_MAX;
+                        next[d] = 0;
+                        calls[depth++] = d;
+                    } else if (low[d] < low[c]) {
+                        low[c] = low[d];
+                    }
+                    continue;
+                }
+                post[c] = rank++;
+                if (post[c] < low[c]) low[c] = post[c];
+                depth--;
+                if (depth > 0 && low[c] < low[calls[depth - 1]]) low[calls[depth - 1]] = low[c];
+            }
+        }
+    }
+    free(calls);
+    free(next);
+    return 0;
+}
+
+// Transitive closure rows, filled in id order so successors come first
+static void fill_closure(Reachability *reach) {
+    int C = reach->components;
+    int words = reach->words;
+    for (int c = 0; c < C; c++) {
+        uint64_t *row = reach->closure + (size_t)c * words;
+        row[c / 64] |= 1ull << (c % 64);
+        for (int64_t i = reach->dag_offsets[c]; i < reach->dag_offsets[c + 1]; i++) {
+            const uint64_t *below = reach->closure + (size_t)reach->dag_targets[i] * words;
+            // Successors have lower ids, so only the low words can be set
+            for (int w = 0; w <= reach->dag_targets[i] / 64; w++) row[w] |= below[w];
+        }
+    }
+}
+
+// Build the index; the closure is kept when it fits in both
+// REACH_BITSET_BYTES and budget
+Reachability *build_reachability(const Graph *graph, size_t budget) {
+    Reachability *reach = calloc(1, sizeof(Reachability));
+    if (!reach) return NULL;
+    reach->V = graph->V;
+    reach->component = malloc(graph->V * sizeof(int));
+    if (!reach->component) goto fail;
+    reach->components = strong_components(graph, reach->component);
+    if (reach->components < 0 || build_dag(reach, graph) != 0) goto fail;
+
+    int C = reach->components;
+    reach->low = malloc((size_t)REACH_INTERVALS * (C ? C : 1) * sizeof(int));
+    reach->post = malloc((size_t)REACH_INTERVALS * (C ? C : 1) * sizeof(int));
+    if (!reach->low || !reach->post || label_intervals(reach) != 0) goto fail;
+
+    reach->words = (C + 63) / 64;
+    size_t closure_bytes = (size_t)C * reach->words * sizeof(uint64_t);
+    if (closure_bytes <= REACH_BITSET_BYTES && closure_bytes <= budget) {
+        reach->closure = calloc((size_t)C * reach->words + 1, sizeof(uint64_t));
+        if (reach->closure) fill_closure(reach);
+    }
+    return reach;
+
+fail:
+    fprintf(stderr, "Out of memory building reachability index\n");
+    free_reachability(reach);
+    return NULL;
+}
+
+static inline bool labels_nest(const Reachability *reach, int from, int to) {
+    int C = reach->components;
+    for (int k = 0; k < REACH_INTERVALS; k++) {
+        const int *low = reach->low + (size_t)k * C;
+        const int *post = reach->post + (size_t)k * C;
+        if (low[to] < low[from] || post[to] > post[from]) return false;
+    }
+    return true;
+}
+
+// O(1) filter: false means end is certainly unreachable from start. Exact
+// when the closure is kept.
+bool may_reach(const Reachability *reach, int start, int end) {
+    int from = reach->component[start];
+    int to = reach->component[end];
+    if (from == to) return true;
+    // DAG edges only lead to lower ids
+    if (to > from) return false;
+    if (reach->closure) return reach->closure[(size_t)from * reach->words + to / 64] >> (to % 64) & 1;
+    return labels_nest(reach, from, to);
+}
+
+// Exact answer; without the closure a DFS over the DAG settles the cases
+// the labels leave open, skipping every component whose labels rule it out
+bool reaches(const Reachability *reach, ReachScratch *scratch, int start, int end) {
+    if (!may_reach(reach, start, end)) return false;
+    int from = reach->component[start];
+    int to = reach->component[end];
+    if (from == to || reach->closure) return true;
+
+    int C = reach->components;
+    if (!scratch->visited) {
+        scratch->visited = calloc(C, sizeof(uint32_t));
+        scratch->stack = malloc(C * sizeof(int));
+        scratch->gen = 0;
+        if (!scratch->visited || !scratch->stack) {
+            free_reach_scratch(scratch);
+            // Cannot rule it out; report it reachable and let the search decide
+            return true;
+        }
+    }
+    if (scratch->gen == UINT32_MAX) {
+        memset(scratch->visited, 0, C * sizeof(uint32_t));
+        scratch->gen = 0;
+    }
+    uint32_t gen = ++scratch->gen;
+    uint32_t *visited = scratch->visited;
+    int *stack = scratch->stack;
+
+    int top = 0;
+    stack[top++] = from;
+    visited[from] = gen;
+    while (top > 0) {
+        int c = stack[--top];
+        for (int64_t i = reach->dag_offsets[c]; i < reach->dag_offsets[c + 1]; i++) {
+            int d = reach->dag_targets[i];
+            if (d == to) return true;
+            if (visited[d] == gen || d < to || !labels_nest(reach, d, to)) continue;
+            visited[d] = gen;
+            stack[top++] = d;
+        }
+    }
+    return false;
+}
+
+void free_reach_scratch(ReachScratch *scratch) {
+    free(scratch->visited);
+    free(scratch->stack);
+    scratch->visited = NULL;
+    scratch->stack = NULL;
+}
+
+void free_reachability(Reachability *reach) {
+    free(reach->component);
+    free(reach->dag_offsets);
+    free(reach->dag_targets);
+    free(reach->low);
+    free(reach->post);
+    free(reach->closure);
+    free(reach);
+}
@@ -0,0 +1,48 @@
+#ifndef REACH_H
+#define REACH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+
+#define REACH_INTERVALS 2
+#define REACH_BITSET_BYTES (64u << 20)
+
+// Vertex reachability, which is all the phases need: every edge can be
+// taken in every phase, so end is reachable from (start, 0) exactly when
+// some path of edges leads there.
+//
+// Strongly connected components are collapsed into a DAG, numbered so
+// every DAG edge goes from a higher to a lower component id. Each
+// component carries REACH_INTERVALS interval labels from post-order DFS
+// traversals; reaching c requires every label of c to nest in ours. When
+// the full transitive closure fits in REACH_BITSET_BYTES it is kept as one
+// bitset row per component and answers are exact in O(1).
+typedef struct Reachability {
+    int V;
+    int components;
+    int *component;          // V: component of each vertex
+    int64_t *dag_offsets;    // components + 1, into dag_targets
+    int *dag_targets;        // Distinct successor components
+    int *low;                // REACH_INTERVALS x components
+    int *post;               // REACH_INTERVALS x components
+    uint64_t *closure;       // components x words, or NULL
+    int words;
+} Reachability;
+
+// DFS state for reaches(), one per thread. Components pushed by the
+// current query carry its generation, so queries neither clear nor
+// allocate; the arrays are allocated by the first query that needs them.
+typedef struct ReachScratch {
+    uint32_t *visited;       // components: generation that last pushed each
+    int *stack;              // components
+    uint32_t gen;
+} ReachScratch;
+
+Reachability *build_reachability(const Graph *graph, size_t budget);
+bool may_reach(const Reachability *reach, int start, int end);
+bool reaches(const Reachability *reach, ReachScratch *scratch, int start, int end);
+void free_reach_scratch(ReachScratch *scratch);
+void free_reachability(Reachability *reach);
+
+#endif // REACH_H
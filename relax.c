@@ -0,0 +1,233 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include "relax.h"
+#include "a8.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RELAX_X86 1
+#include <immintrin.h>
+#endif
+
+// Scalar scan of edges from .. count - 1, appending after the found
+// indices already in improved. Returns the new total.
+static inline int scan_scalar(const int *targets, const int *weights, int from, int count,
+                              int cost, int N, int next_step, const int *dist,
+                              const uint32_t *stamp, uint32_t labelled, int *improved, int found) {
+    for (int i = from; i < count; i++) {
+        size_t t = (size_t)targets[i] * N + next_step;
+        int candidate = cost + weights[i];
+        // Settled states have stamp labelled + 1 and never improve
+        if (stamp[t] < labelled || (stamp[t] == labelled && candidate < dist[t])) {
+            improved[found++] = i;
+        }
+    }
+    return found;
+}
+
+static int relax_scalar(const int *targets, const int *weights, int count, int cost,
+                        int N, int next_step, const int *dist, const uint32_t *stamp,
+                        uint32_t labelled, int *improved) {
+    return scan_scalar(targets, weights, 0, count, cost, N, next_step, dist, stamp,
+                       labelled, improved, 0);
+}
+
+// Profile lanes from k on. Sums are unsigned so INF + weight stays above
+// every real cost instead of wrapping negative.
+static inline int profile_scalar(const int *from, int weight, int *to, int *prev, int u,
+                                 int k, int N, int least) {
+    for (; k < N; k++) {
+        unsigned candidate = (unsigned)from[k] + (unsigned)weight;
+        if (candidate < (unsigned)to[k]) {
+            to[k] = (int)candidate;
+            prev[k] = u;
+            if ((int)candidate < least) least = (int)candidate;
+        }
+    }
+    return least;
+}
+
+static int profile_relax_scalar(const int *from, int weight, int *to, int *prev, int u, int N) {
+    return profile_scalar(from, weight, to, prev, u, 0, N, INF);
+}
+
+#ifdef RELAX_X86
+
+// The lane tests are the scalar test spelled with equalities: stamps never
+// run ahead of the current search, so a state that is neither labelled nor
+// settled is unreached and improves whatever its stale dist says.
+
+__attribute__((target("sse4.1")))
+static int relax_sse4(const int *targets, const int *weights, int count, int cost,
+                      int N, int next_step, const int *dist, const uint32_t *stamp,
+                      uint32_t labelled, int *improved) {
+    const __m128i vcost = _mm_set1_epi32(cost);
+    const __m128i vlabelled = _mm_set1_epi32((int)labelled);
+    const __m128i vsettled = _mm_set1_epi32((int)(labelled + 1));
+    const __m128i ones = _mm_set1_epi32(-1);
+    int found = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(targets + i));
+        __m128i candidate = _mm_add_epi32(vcost, _mm_loadu_si128((const __m128i *)(weights + i)));
+        size_t t0 = (size_t)(uint32_t)_mm_extract_epi32(v, 0) * N + next_step;
+        size_t t1 = (size_t)(uint32_t)_mm_extract_epi32(v, 1) * N + next_step;
+        size_t t2 = (size_t)(uint32_t)_mm_extract_epi32(v, 2) * N + next_step;
+        size_t t3 = (size_t)(uint32_t)_mm_extract_epi32(v, 3) * N + next_step;
+        __m128i d = _mm_setr_epi32(dist[t0], dist[t1], dist[t2], dist[t3]);
+        __m128i s = _mm_setr_epi32((int)stamp[t0], (int)stamp[t1], (int)stamp[t2], (int)stamp[t3]);
+
+        __m128i unreached = _mm_xor_si128(_mm_cmpeq_epi32(s, vlabelled), ones);
+        __m128i open = _mm_or_si128(unreached, _mm_cmpgt_epi32(d, candidate));
+        __m128i improve = _mm_andnot_si128(_mm_cmpeq_epi32(s, vsettled), open);
+        unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(improve));
+        while (mask) {
+            improved[found++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return scan_scalar(targets, weights, i, count, cost, N, next_step, dist, stamp,
+                       labelled, improved, found);
+}
+
+// Gather four 32-bit labels at the 64-bit state indices of one half
+__attribute__((target("avx2")))
+static inline __m128i gather_half(const void *base, __m128i vertices, __m256i vN, __m256i vstep) {
+    __m256i index = _mm256_add_epi64(_mm256_mul_epu32(_mm256_cvtepu32_epi64(vertices), vN), vstep);
+    return _mm256_i64gather_epi32((const int *)base, index, 4);
+}
+
+__attribute__((target("avx2")))
+static int relax_avx2(const int *targets, const int *weights, int count, int cost,
+                      int N, int next_step, const int *dist, const uint32_t *stamp,
+                      uint32_t labelled, int *improved) {
+    const __m256i vcost = _mm256_set1_epi32(cost);
+    const __m256i vlabelled = _mm256_set1_epi32((int)labelled);
+    const __m256i vsettled = _mm256_set1_epi32((int)(labelled + 1));
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i vN = _mm256_set1_epi64x(N);
+    const __m256i vstep = _mm256_set1_epi64x(next_step);
+    int found = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(targets + i));
+        __m256i candidate = _mm256_add_epi32(vcost, _mm256_loadu_si256((const __m256i *)(weights + i)));
+        __m128i low = _mm256_castsi256_si128(v);
+        __m128i high = _mm256_extracti128_si256(v, 1);
+        __m256i d = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(gather_half(dist, low, vN, vstep)),
+            gather_half(dist, high, vN, vstep), 1);
+        __m256i s = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(gather_half(stamp, low, vN, vstep)),
+            gather_half(stamp, high, vN, vstep), 1);
+
+        __m256i unreached = _mm256_xor_si256(_mm256_cmpeq_epi32(s, vlabelled), ones);
+        __m256i open = _mm256_or_si256(unreached, _mm256_cmpgt_epi32(d, candidate));
+        __m256i improve = _mm256_andnot_si256(_mm256_cmpeq_epi32(s, vsettled), open);
+        unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(improve));
+        while (mask) {
+            improved[found++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return scan_scalar(targets, weights, i, count, cost, N, next_step, dist, stamp,
+                       labelled, improved, found);
+}
+
+// Profile lanes four at a time from k on. Unchanged lanes are OR-ed to
+// all ones so the unsigned minimum only sees lowered costs.
+__attribute__((target("sse4.1")))
+static inline int profile_sse4_from(const int *from, int weight, int *to, int *prev, int u,
+                                    int k, int N, int least) {
+    const __m128i vweight = _mm_set1_epi32(weight);
+    const __m128i vu = _mm_set1_epi32(u);
+    __m128i lowest = _mm_set1_epi32(-1);
+    for (; k + 4 <= N; k += 4) {
+        __m128i candidate = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(from + k)), vweight);
+        __m128i old = _mm_loadu_si128((const __m128i *)(to + k));
+        __m128i lowered = _mm_min_epu32(candidate, old);
+        __m128i same = _mm_cmpeq_epi32(lowered, old);
+        _mm_storeu_si128((__m128i *)(to + k), lowered);
+        __m128i p = _mm_loadu_si128((const __m128i *)(prev + k));
+        _mm_storeu_si128((__m128i *)(prev + k), _mm_blendv_epi8(vu, p, same));
+        lowest = _mm_min_epu32(lowest, _mm_or_si128(lowered, same));
+    }
+    lowest = _mm_min_epu32(lowest, _mm_shuffle_epi32(lowest, _MM_SHUFFLE(1, 0, 3, 2)));
+    lowest = _mm_min_epu32(lowest, _mm_shuffle_epi32(lowest, _MM_SHUFFLE(2, 3, 0, 1)));
+    unsigned found = (unsigned)_mm_cvtsi128_si32(lowest);
+    if (found < (unsigned)least) least = (int)found;
+    return profile_scalar(from, weight, to, prev, u, k, N, least);
+}
+
+__attribute__((target("sse4.1")))
+static int profile_relax_sse4(const int *from, int weight, int *to, int *prev, int u, int N) {
+    return profile_sse4_from(from, weight, to, prev, u, 0, N, INF);
+}
+
+__attribute__((target("avx2")))
+static int profile_relax_avx2(const int *from, int weight, int *to, int *prev, int u, int N) {
+    const __m256i vweight = _mm256_set1_epi32(weight);
+    const __m256i vu = _mm256_set1_epi32(u);
+    __m256i lowest = _mm256_set1_epi32(-1);
+    int k = 0;
+    for (; k + 8 <= N; k += 8) {
+        __m256i candidate = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(from + k)), vweight);
+        __m256i old = _mm256_loadu_si256((const __m256i *)(to + k));
+        __m256i lowered = _mm256_min_epu32(candidate, old);
+        __m256i same = _mm256_cmpeq_epi32(lowered, old);
+        _mm256_storeu_si256((__m256i *)(to + k), lowered);
+        __m256i p = _mm256_loadu_si256((const __m256i *)(prev + k));
+        _mm256_storeu_si256((__m256i *)(prev + k), _mm256_blendv_epi8(vu, p, same));
+        lowest = _mm256_min_epu32(lowest, _mm256_or_si256(lowered, same));
+    }
+    __m128i half = _mm_min_epu32(_mm256_castsi256_si128(lowest), _mm256_extracti128_si256(lowest, 1));
+    half = _mm_min_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_min_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    unsigned found = (unsigned)_mm_cvtsi128_si32(half);
+    return profile_sse4_from(from, weight, to, prev, u, k, N, found < (unsigned)INF ? (int)found : INF);
+}
+
+#endif // RELAX_X86
+
+// Resolve auto, and step down from a kernel the CPU cannot run
+Kernel select_kernel(Kernel requested) {
+#ifdef RELAX_X86
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse4 = __builtin_cpu_supports("sse4.1");
+#else
+    bool avx2 = false;
+    bool sse4 = false;
+#endif
+    if (requested == KERNEL_SCALAR) return KERNEL_SCALAR;
+    if (requested != KERNEL_SSE4 && avx2) return KERNEL_AVX2;
+    return sse4 ? KERNEL_SSE4 : KERNEL_SCALAR;
+}
+
+const char *kernel_name(Kernel kernel) {
+    switch (kernel) {
+    case KERNEL_SCALAR: return "scalar";
+    case KERNEL_SSE4: return "sse4";
+    case KERNEL_AVX2: return "avx2";
+    default: return "auto";
+    }
+}
+
+RelaxFn relax_function(Kernel kernel) {
+    switch (kernel) {
+#ifdef RELAX_X86
+    case KERNEL_SSE4: return relax_sse4;
+    case KERNEL_AVX2: return relax_avx2;
+#endif
+    default: return relax_scalar;
+    }
+}
+
+ProfileRelaxFn profile_relax_function(Kernel kernel) {
+    switch (kernel) {
+#ifdef RELAX_X86
+    case KERNEL_SSE4: return profile_relax_sse4;
+    case KERNEL_AVX2: return profile_relax_avx2;
+#endif
+    default: return profile_relax_scalar;
+    }
+}
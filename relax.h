@@ -0,0 +1,37 @@
+#ifndef RELAX_H
+#define RELAX_H
+
+#include <stdint.h>
+
+// Rows shorter than this are relaxed by the plain loop in the search
+#define RELAX_MIN_DEGREE 16
+// Edges scanned per kernel call, bounding the improved-index buffer
+#define RELAX_CHUNK 256
+
+// Edge relaxation kernels, chosen once per run from what the CPU offers
+typedef enum Kernel {
+    KERNEL_AUTO,         // Widest kernel the CPU supports
+    KERNEL_SCALAR,       // One edge at a time
+    KERNEL_SSE4,         // Four edges per step, scalar loads of the labels
+    KERNEL_AVX2          // Eight edges per step, gathered labels
+} Kernel;
+
+// Scan count edges of one settled state at cost and write the indices
+// (into targets) of those whose state in next_step would improve to
+// improved. Returns how many were written. The caller applies them in
+// order and rechecks each one, since a row can name the same target twice.
+typedef int (*RelaxFn)(const int *targets, const int *weights, int count, int cost,
+                       int N, int next_step, const int *dist, const uint32_t *stamp,
+                       uint32_t labelled, int *improved);
+
+// Min-plus step of a profile search: lower each of the N departure costs
+// in to to from + weight where that is cheaper, recording u as their
+// predecessor. Returns the least cost lowered, or INF when none was.
+typedef int (*ProfileRelaxFn)(const int *from, int weight, int *to, int *prev, int u, int N);
+
+Kernel select_kernel(Kernel requested);
+const char *kernel_name(Kernel kernel);
+RelaxFn relax_function(Kernel kernel);
+ProfileRelaxFn profile_relax_function(Kernel kernel);
+
+#endif // RELAX_H
@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "reorder.h"
+
+#define PERIPHERAL_ROUNDS 8
+
+static int compare_keys(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y);
+}
+
+// Both directions of every edge, so components and distances ignore
+// which way the edges point
+static int build_undirected(const Graph *graph, int64_t **offsets_out, int **neighbors_out) {
+    int V = graph->V;
+    int64_t E = graph->E;
+    int64_t *offsets = calloc((size_t)V + 1, sizeof(int64_t));
+    int64_t *fill = malloc(((size_t)V + 1) * sizeof(int64_t));
+    int *neighbors = malloc((E ? 2 * E : 1) * sizeof(int));
+    if (!offsets || !fill || !neighbors) {
+        free(offsets);
+        free(fill);
+        free(neighbors);
+        return -1;
+    }
+    for (int u = 0; u < V; u++) {
+        offsets[u + 1] += graph->offsets[u + 1] - graph->offsets[u];
+        for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            offsets[graph->targets[e] + 1]++;
+        }
+    }
+    for (int v = 0; v < V; v++) offsets[v + 1] += offsets[v];
+    memcpy(fill, offsets, ((size_t)V + 1) * sizeof(int64_t));
+    for (int u = 0; u < V; u++) {
+        for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            int v = graph->targets[e];
+            neighbors[fill[u]++] = v;
+            neighbors[fill[v]++] = u;
+        }
+    }
+    free(fill);
+    *offsets_out = offsets;
+    *neighbors_out = neighbors;
+    return 0;
+}
+
+// Breadth-first levels from root; returns the eccentricity and leaves the
+// visited vertices in queue[0 .. *visited - 1] with their level set
+static int bfs_levels(const int64_t *offsets, const int *neighbors, int root,
+                      int *level, int *queue, int *visited) {
+    int head = 0;
+    int tail = 0;
+    level[root] = 0;
+    queue[tail++] = root;
+    while (head < tail) {
+        int u = queue[head++];
+        for (int64_t k = offsets[u]; k < offsets[u + 1]; k++) {
+            int w = neighbors[k];
+            if (level[w] < 0) {
+                level[w] = level[u] + 1;
+                queue[tail++] = w;
+            }
+        }
+    }
+    *visited = tail;
+    return level[queue[tail - 1]];
+}
+
+// George-Liu: hop to a lowest-degree vertex of the last BFS level until
+// the eccentricity stops growing
+static int pseudo_peripheral(const int64_t *offsets, const int *neighbors, int seed,
+                             int *level, int *queue) {
+    int root = seed;
+    int visited;
+    int eccentricity = bfs_levels(offsets, neighbors, root, level, queue, &visited);
+    for (int round = 0; round < PERIPHERAL_ROUNDS; round++) {
+        int best = -1;
+        int64_t best_degree = 0;
+        for (int i = visited - 1; i >= 0 && level[queue[i]] == eccentricity; i--) {
+            int v = queue[i];
+            int64_t degree = offsets[v + 1] - offsets[v];
+            if (best < 0 || degree < best_degree) {
+                best = v;
+                best_degree = degree;
+            }
+        }
+        for (int i = 0; i < visited; i++) level[queue[i]] = -1;
+        int candidate_ecc = bfs_levels(offsets, neighbors, best, level, queue, &visited);
+        if (candidate_ecc <= eccentricity) break;
+        root = best;
+        eccentricity = candidate_ecc;
+    }
+    for (int i = 0; i < visited; i++) level[queue[i]] = -1;
+    return root;
+}
+
+Ordering *build_ordering(const Graph *graph, OrderStrategy strategy) {
+    int V = graph->V;
+    int64_t *offsets = NULL;
+    int *neighbors = NULL;
+    Ordering *ordering = calloc(1, sizeof(Ordering));
+    int *level = malloc((V ? V : 1) * sizeof(int));
+    int *queue = malloc((V ? V : 1) * sizeof(int));
+    uint64_t *keys = NULL;
+    if (!ordering || !level || !queue || build_undirected(graph, &offsets, &neighbors) != 0) {
+        goto fail;
+    }
+    ordering->V = V;
+    ordering->to_inner = malloc((V ? V : 1) * sizeof(int));
+    ordering->to_outer = malloc((V ? V : 1) * sizeof(int));
+    int64_t max_degree = 0;
+    for (int v = 0; v < V; v++) {
+        if (offsets[v + 1] - offsets[v] > max_degree) max_degree = offsets[v + 1] - offsets[v];
+    }
+    keys = malloc((max_degree ? max_degree : 1) * sizeof(uint64_t));
+    if (!ordering->to_inner || !ordering->to_outer || !keys) goto fail;
+
+    // to_outer doubles as the BFS queue; to_inner marks placed vertices
+    int *order = ordering->to_outer;
+    for (int v = 0; v < V; v++) {
+        level[v] = -1;
+        ordering->to_inner[v] = -1;
+    }
+    int placed = 0;
+    for (int seed = 0; seed < V; seed++) {
+        if (ordering->to_inner[seed] >= 0) continue;
+        int root = seed;
+        if (strategy == ORDER_RCM) root = pseudo_peripheral(offsets, neighbors, seed, level, queue);
+        ordering->to_inner[root] = placed;
+        order[placed++] = root;
+        for (int head = placed - 1; head < placed; head++) {
+            int u = order[head];
+            int begin = placed;
+            for (int64_t k = offsets[u]; k < offsets[u + 1]; k++) {
+                int w = neighbors[k];
+                if (ordering->to_inner[w] >= 0) continue;
+                ordering->to_inner[w] = placed;
+                order[placed++] = w;
+            }
+            if (strategy != ORDER_RCM || placed - begin < 2) continue;
+            // Cuthill-McKee enqueues the new neighbors by increasing degree
+            int count = placed - begin;
+            for (int i = 0; i < count; i++) {
+                int w = order[begin + i];
+                keys[i] = (uint64_t)(offsets[w + 1] - offsets[w]) << 32 | (uint32_t)w;
+            }
+            qsort(keys, count, sizeof(uint64_t), compare_keys);
+            for (int i = 0; i < count; i++) order[begin + i] = (int)(uint32_t)keys[i];
+        }
+    }
+    if (strategy == ORDER_RCM) {
+        for (int i = 0, j = V - 1; i < j; i++, j--) {
+            int t = order[i];
+            order[i] = order[j];
+            order[j] = t;
+        }
+    }
+    for (int i = 0; i < V; i++) ordering->to_inner[order[i]] = i;
+
+    free(offsets);
+    free(neighbors);
+    free(level);
+    free(queue);
+    free(keys);
+    return ordering;
+
+fail:
+    fprintf(stderr, "Out of memory computing vertex order\n");
+    free(offsets);
+    free(neighbors);
+    free(level);
+    free(queue);
+    free(keys);
+    if (ordering) free_ordering(ordering);
+    return NULL;
+}
+
+// Rebuild the CSR arrays in inner ids. Rows follow the new order and each
+// row lists its targets by increasing inner id, so a scan walks the state
+// arrays forwards. The reverse arrays are dropped and rebuilt on demand.
+int apply_ordering(Graph *graph, const Ordering *ordering) {
+    int V = graph->V;
+    int N = graph->N;
+    int64_t E = graph->E;
+    size_t nweights = (size_t)N * E;
+    int64_t max_degree = 0;
+    for (int u = 0; u < V; u++) {
+        if (graph->offsets[u + 1] - graph->offsets[u] > max_degree) {
+            max_degree = graph->offsets[u + 1] - graph->offsets[u];
+        }
+    }
+
+    int64_t *offsets = malloc(((size_t)V + 1) * sizeof(int64_t));
+    int *targets = malloc((E ? E : 1) * sizeof(int));
+    int *weights = malloc((nweights ? nweights : 1) * sizeof(int));
+    int64_t *source_edge = malloc((E ? E : 1) * sizeof(int64_t));
+    uint64_t *keys = malloc((max_degree ? max_degree : 1) * sizeof(uint64_t));
+    if (!offsets || !targets || !weights || !source_edge || !keys) {
+        fprintf(stderr, "Out of memory renumbering graph\n");
+        free(offsets);
+        free(targets);
+        free(weights);
+        free(source_edge);
+        free(keys);
+        return -1;
+    }
+
+    int64_t e = 0;
+    for (int nu = 0; nu < V; nu++) {
+        int u = ordering->to_outer[nu];
+        int64_t begin = graph->offsets[u];
+        int64_t degree = graph->offsets[u + 1] - begin;
+        offsets[nu] = e;
+        for (int64_t k = 0; k < degree; k++) {
+            keys[k] = (uint64_t)ordering->to_inner[graph->targets[begin + k]] << 32 | (uint32_t)k;
+        }
+        qsort(keys, degree, sizeof(uint64_t), compare_keys);
+        for (int64_t k = 0; k < degree; k++, e++) {
+            targets[e] = (int)(keys[k] >> 32);
+            source_edge[e] = begin + (uint32_t)keys[k];
+        }
+    }
+    offsets[V] = e;
+    for (int p = 0; p < N; p++) {
+        const int *from = graph->weights + (size_t)p * E;
+        int *to = weights + (size_t)p * E;
+        for (int64_t k = 0; k < E; k++) to[k] = from[source_edge[k]];
+    }
+    free(source_edge);
+    free(keys);
+
+    if (graph->mapping) {
+        munmap(graph->mapping, graph->mapping_size);
+        graph->mapping = NULL;
+        graph->mapping_size = 0;
+    } else {
+        free(graph->offsets);
+        free(graph->targets);
+        free(graph->weights);
+    }
+    graph->offsets = offsets;
+    graph->targets = targets;
+    graph->weights = weights;
+
+    free(graph->rev_offsets);
+    free(graph->rev_sources);
+    free(graph->rev_weights);
+    graph->rev_offsets = NULL;
+    graph->rev_sources = NULL;
+    graph->rev_weights = NULL;
+    return 0;
+}
+
+void free_ordering(Ordering *ordering) {
+    free(ordering->to_inner);
+    free(ordering->to_outer);
+    free(ordering);
+}
@@ -0,0 +1,26 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include "graph.h"
+
+typedef enum OrderStrategy {
+    ORDER_BFS,   // Breadth-first from the lowest id of each component
+    ORDER_RCM    // Reverse Cuthill-McKee from a pseudo-peripheral vertex
+} OrderStrategy;
+
+// Load-time renumbering of the vertices
+//
+// Searches run on inner ids, chosen so that vertices close in the graph
+// sit close in the CSR rows and in the V x N state arrays. Queries and
+// printed paths keep the outer ids of the input file.
+typedef struct Ordering {
+    int V;
+    int *to_inner;       // Outer id -> inner id
+    int *to_outer;       // Inner id -> outer id
+} Ordering;
+
+Ordering *build_ordering(const Graph *graph, OrderStrategy strategy);
+int apply_ordering(Graph *graph, const Ordering *ordering);
+void free_ordering(Ordering *ordering);
+
+#endif // REORDER_H
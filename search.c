@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "search.h"
+#include "perf.h"
+
+// Bytes of per-state search storage (dist, prev, stamp and, for the heap
+// engine, the heap slot) for V x N states, twice over for the searches
+// that also run backwards, plus the touched list of a cached search and
+// the N-wide labels of a profile search
+size_t search_state_bytes(int V, int N, const SearchConfig *config) {
+    size_t per_state = sizeof(int) + sizeof(int) + sizeof(uint32_t);
+    if (config->engine == ENGINE_HEAP || config->engine == ENGINE_AUTO) per_state += sizeof(uint32_t);
+    if (config->bidirectional || config->hierarchy) per_state *= 2;
+    if (config->cache) per_state += sizeof(uint32_t);
+    if (config->profile) per_state += 2 * (size_t)N * sizeof(int);
+    return (size_t)V * N * per_state;
+}
+
+// Function to create a workspace for searches on graph
+Workspace *create_workspace(const Graph *graph, const SearchConfig *config) {
+    Workspace *ws = calloc(1, sizeof(Workspace));
+    if (!ws) return NULL;
+    ws->graph = graph;
+    ws->config = config;
+    ws->states = (size_t)graph->V * graph->N;
+    ws->dist = malloc(ws->states * sizeof(int));
+    ws->prev = malloc(ws->states * sizeof(int));
+    ws->stamp = calloc(ws->states, sizeof(uint32_t));
+    ws->target = calloc(graph->V, sizeof(uint32_t));
+    ws->gen = 0;
+    ws->queue = create_queue(config->engine, ws->states, graph->max_weight);
+    if (config->landmarks) {
+        ws->heur = malloc(graph->V * sizeof(int));
+        ws->heur_stamp = calloc(graph->V, sizeof(uint32_t));
+        if (!ws->heur || !ws->heur_stamp) {
+            free_workspace(ws);
+            return NULL;
+        }
+    }
+    if (config->profile) {
+        ws->pdist = malloc(ws->states * graph->N * sizeof(int));
+        ws->pprev = malloc(ws->states * graph->N * sizeof(int));
+        if (!ws->pdist || !ws->pprev) {
+            free_workspace(ws);
+            return NULL;
+        }
+    }
+    if (config->cache) {
+        ws->touched = malloc(ws->states * sizeof(uint32_t));
+        if (!ws->touched) {
+            free_workspace(ws);
+            return NULL;
+        }
+    }
+    if (config->bidirectional || config->hierarchy) {
+        ws->bdist = malloc(ws->states * sizeof(int));
+        ws->bnext = malloc(ws->states * sizeof(int));
+        ws->bstamp = calloc(ws->states, sizeof(uint32_t));
+        ws->bqueue = create_queue(config->engine, ws->states, graph->max_weight);
+        if (!ws->bdist || !ws->bnext || !ws->bstamp || !ws->bqueue) {
+            free_workspace(ws);
+            return NULL;
+        }
+    }
+    if (!ws->dist || !ws->prev || !ws->stamp || !ws->target || !ws->queue) {
+        free_workspace(ws);
+        return NULL;
+    }
+    return ws;
+}
+
+void free_workspace(Workspace *ws) {
+    free(ws->dist);
+    free(ws->prev);
+    free(ws->stamp);
+    free(ws->target);
+    free(ws->heur);
+    free(ws->heur_stamp);
+    free(ws->touched);
+    free(ws->pdist);
+    free(ws->pprev);
+    if (ws->queue) free_queue(ws->queue);
+    free(ws->bdist);
+    free(ws->bnext);
+    free(ws->bstamp);
+    if (ws->bqueue) free_queue(ws->bqueue);
+    if (ws->perf) close_perf_counters(ws->perf);
+    free(ws);
+}
+
+// Start a new search: invalidate every label in O(1) and empty the queue
+void begin_search(Workspace *ws) {
+    if (ws->gen >= UINT32_MAX - 3) {
+        // Stamps would wrap; clear them once every two billion queries
+        memset(ws->stamp, 0, ws->states * sizeof(uint32_t));
+        memset(ws->target, 0, ws->graph->V * sizeof(uint32_t));
+        if (ws->heur_stamp) memset(ws->heur_stamp, 0, ws->graph->V * sizeof(uint32_t));
+        if (ws->bstamp) memset(ws->bstamp, 0, ws->states * sizeof(uint32_t));
+        ws->gen = 0;
+    }
+    ws->gen += 2;
+    clear_queue(ws->queue);
+    if (ws->bqueue) clear_queue(ws->bqueue);
+}
+
+// Build the cheapest path to end from the current search's labels, or
+// return NULL if no phase of end was reached
+int *extract_path(Workspace *ws, int end, int *path_len) {
+    int N = ws->graph->N;
+
+    // Find the minimum cost to reach the end node across all steps
+    int min_cost = INF;
+    int final_step = -1;
+    for (int i = 0; i < N; i++) {
+        int d = state_dist(ws, (size_t)end * N + i);
+        if (d < min_cost) {
+            min_cost = d;
+            final_step = i;
+        }
+    }
+
+    *path_len = 0;
+    if (min_cost == INF) return NULL;
+
+    // Reconstruct the path; a walk can revisit a vertex in another
+    // phase, so it is sized by walking the chain first
+    int len = 0;
+    for (int at = end, step = final_step; at != -1; step = (step - 1 + N) % N) {
+        len++;
+        at = ws->prev[(size_t)at * N + step];
+    }
+    int *path = malloc(len * sizeof(int));
+    if (!path) return NULL;
+
+    for (int at = end, step = final_step; at != -1; step = (step - 1 + N) % N) {
+        path[(*path_len)++] = at;
+        at = ws->prev[(size_t)at * N + step];
+    }
+
+    // Reverse the path to get start → end
+    for (int i = 0; i < *path_len / 2; i++) {
+        int temp = path[i];
+        path[i] = path[*path_len - i - 1];
+        path[*path_len - i - 1] = temp;
+    }
+    return path;
+}
+
+// Label state t through an edge from u at new_cost if that improves it
+static inline void relax_edge(Workspace *ws, int u, size_t t, int new_cost, uint32_t labelled) {
+    uint32_t *stamp = ws->stamp;
+    if (stamp[t] < labelled || (stamp[t] == labelled && new_cost < ws->dist[t])) {
+        if (ws->touched && stamp[t] < labelled) ws->touched[ws->ntouched++] = t;
+        ws->dist[t] = new_cost;
+        ws->prev[t] = u;
+        stamp[t] = labelled;
+        STAT_ADD(ws->stats, improvements, 1);
+        STAT_ADD(ws->stats, pushes, 1);
+        if (queue_push(ws->queue, t, new_cost) != 0) {
+            fprintf(stderr, "Out of memory growing queue\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Dijkstra's algorithm with periodic weights from (start, phase), run
+// until some phase of every target vertex is settled (or nothing is left to
+// expand). The labels stay in ws for extract_path(). Returns the number of
+// targets that were reached.
+int search_targets(Workspace *ws, int start, int phase, const int *targets, int ntargets) {
+    int N = ws->graph->N;
+    begin_search(ws);
+    ws->ntouched = 0;
+
+    // Initialize the starting vertex
+    size_t origin = (size_t)start * N + phase;
+    ws->dist[origin] = 0;
+    ws->prev[origin] = -1;
+    ws->stamp[origin] = ws->gen;
+    if (ws->touched) ws->touched[ws->ntouched++] = origin;
+    queue_push(ws->queue, origin, 0); // Push start node into queue
+    STAT_ADD(ws->stats, pushes, 1);
+    return continue_search(ws, targets, ntargets);
+}
+
+// Run the search whose labels and queue are in ws, which search_targets()
+// seeded or a cache restored, until some phase of every target is settled.
+// Targets settled before the call count as reached without more work.
+int continue_search(Workspace *ws, const int *targets, int ntargets) {
+    const Graph *graph = ws->graph;
+    int N = graph->N;
+    int *dist = ws->dist;
+    uint32_t *stamp = ws->stamp;
+    Queue *queue = ws->queue;
+    RelaxFn relax = relax_function(ws->config->kernel);
+    int improved[RELAX_CHUNK];
+    uint32_t labelled = ws->gen;
+    uint32_t settled = ws->gen + 1;
+
+    int pending = 0;
+    int wanted = 0;
+    for (int i = 0; i < ntargets; i++) {
+        int v = targets[i];
+        if (ws->target[v] == labelled || ws->target[v] == settled) continue;
+        wanted++;
+        bool reached = false;
+        for (int p = 0; p < N && !reached; p++) reached = is_settled(ws, (size_t)v * N + p);
+        ws->target[v] = reached ? settled : labelled;
+        pending += !reached;
+    }
+    ws->unexpanded = HEAP_ABSENT;
+
+    HeapEntry current;
+    while (pending && pop_state(queue, &current)) {
+        size_t s = current.state;
+        int u = s / N;
+        int step = s % N;
+        int current_cost = current.key;
+
+        STAT_ADD(ws->stats, pops, 1);
+        // Bucket engines leave stale copies of improved states behind
+        if (stamp[s] == settled) {
+            STAT_ADD(ws->stats, stale_pops, 1);
+            continue;
+        }
+        stamp[s] = settled;
+        STAT_ADD(ws->stats, settled, 1);
+
+        if (ws->target[u] == labelled) {
+            ws->target[u] = settled;
+            if (--pending == 0) {
+                ws->unexpanded = s;
+                break;
+            }
+        }
+
+        // Explore neighbors: a linear walk over u's CSR row, reading this
+        // phase's contiguous weight block
+        int next_step = (step + 1) % N;
+        const int *weights = graph->weights + (size_t)step * graph->E;
+        int64_t first = graph->offsets[u];
+        int64_t last = graph->offsets[u + 1];
+        STAT_ADD(ws->stats, relaxations, last - first);
+        STAT_MAX(ws->stats, max_queue, queue_size(queue));
+        if (last - first < RELAX_MIN_DEGREE) {
+            for (int64_t e = first; e < last; e++) {
+                relax_edge(ws, u, (size_t)graph->targets[e] * N + next_step,
+                           current_cost + weights[e], labelled);
+            }
+            continue;
+        }
+        // Long rows: the kernel finds the improving edges a chunk at a
+        // time, then they are applied in row order
+        for (int64_t chunk = first; chunk < last; chunk += RELAX_CHUNK) {
+            int count = last - chunk < RELAX_CHUNK ? (int)(last - chunk) : RELAX_CHUNK;
+            int found = relax(graph->targets + chunk, weights + chunk, count, current_cost,
+                              N, next_step, dist, stamp, labelled, improved);
+            for (int k = 0; k < found; k++) {
+                int64_t e = chunk + improved[k];
+                relax_edge(ws, u, (size_t)graph->targets[e] * N + next_step,
+                           current_cost + weights[e], labelled);
+            }
+        }
+    }
+
+    return wanted - pending;
+}
+
+// Single-pair query departing in phase: search until end is settled and
+// return its path
+int *dijkstra(Workspace *ws, int start, int phase, int end, int *path_len) {
+    search_targets(ws, start, phase, &end, 1);
+    return extract_path(ws, end, path_len);
+}
@@ -0,0 +1,115 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "a8.h"
+#include "graph.h"
+#include "queue.h"
+#include "relax.h"
+#include "stats.h"
+
+struct Landmarks;
+struct Oracle;
+struct Hierarchy;
+struct Reachability;
+struct Ordering;
+struct PerfCounters;
+struct HotTrees;
+struct SearchCache;
+
+// Options shared by every workspace of a run
+typedef struct SearchConfig {
+    Engine engine;
+    Kernel kernel;                       // Relaxation kernel for long rows
+    const struct Landmarks *landmarks;   // Goal-directed A* when set
+    bool bidirectional;                  // Meet-in-the-middle searches
+    const struct Oracle *oracle;         // Precomputed answers when set
+    const struct Hierarchy *hierarchy;   // Contraction hierarchy queries when set
+    const struct Reachability *reach;    // Rejects unreachable ends before searching
+    const struct Ordering *ordering;     // Maps query ids to the graph's renumbered ids
+    bool perf;                           // Read hardware counters around searches
+    struct HotTrees *hot;                // Retained trees of hot sources, with --updates
+    struct SearchCache *cache;           // Suspended searches to resume, when set
+    bool profile;                        // Answer every departure phase at once
+} SearchConfig;
+
+// Per-thread search state, reused across queries
+//
+// dist and prev are only meaningful for states whose stamp belongs to the
+// current search: stamp == gen means labelled, stamp == gen + 1 means
+// settled, anything lower is left over from an earlier query and reads as
+// unreached. Starting a search bumps gen by two instead of clearing V x N
+// entries, so a query only pays for the states it touches.
+typedef struct Workspace {
+    const Graph *graph;
+    const SearchConfig *config;
+    size_t states;       // V * N
+    int *dist;           // Tentative cost per state
+    int *prev;           // Predecessor vertex per state (phase is one less)
+    uint32_t *stamp;     // Generation that last touched each state
+    uint32_t gen;        // Generation of the current search
+    uint32_t *target;    // Per vertex: gen while it is a pending target
+    int *heur;           // Per vertex A* bound, valid when heur_stamp == gen
+    uint32_t *heur_stamp;
+    Queue *queue;
+    SearchStats stats;   // Counters of the current search (A8_STATS builds)
+    struct PerfCounters *perf;   // Opened by the first search on this thread
+    bool perf_failed;            // Opening them failed; do not retry
+
+    // With a search cache: every state labelled by the current search, in
+    // labelling order, and the settled state whose edges it stopped short
+    // of scanning (HEAP_ABSENT when it ran dry)
+    uint32_t *touched;
+    size_t ntouched;
+    uint32_t unexpanded;
+
+    // Profile searches: N costs per state, one per departure phase, and
+    // the predecessor vertex of each
+    int *pdist;
+    int *pprev;
+
+    // Backward half of a bidirectional search, stamped like the forward one
+    int *bdist;          // Cost from each state to end
+    int *bnext;          // Successor vertex per state (phase is one more)
+    uint32_t *bstamp;
+    Queue *bqueue;
+} Workspace;
+
+size_t search_state_bytes(int V, int N, const SearchConfig *config);
+Workspace *create_workspace(const Graph *graph, const SearchConfig *config);
+void free_workspace(Workspace *ws);
+
+void begin_search(Workspace *ws);
+int *extract_path(Workspace *ws, int end, int *path_len);
+int search_targets(Workspace *ws, int start, int phase, const int *targets, int ntargets);
+int continue_search(Workspace *ws, const int *targets, int ntargets);
+int *dijkstra(Workspace *ws, int start, int phase, int end, int *path_len);
+
+static inline bool is_labelled(const Workspace *ws, size_t s) {
+    return ws->stamp[s] >= ws->gen;
+}
+
+static inline bool is_settled(const Workspace *ws, size_t s) {
+    return ws->stamp[s] == ws->gen + 1;
+}
+
+static inline int state_dist(const Workspace *ws, size_t s) {
+    return is_labelled(ws, s) ? ws->dist[s] : INF;
+}
+
+// Pop the next state of a search; running out of memory here ends the
+// run like a failed push does
+static inline bool pop_state(Queue *queue, HeapEntry *out) {
+    int popped = queue_pop(queue, out);
+    if (popped < 0) {
+        fprintf(stderr, "Out of memory growing queue\n");
+        exit(EXIT_FAILURE);
+    }
+    return popped > 0;
+}
+
+#endif // SEARCH_H
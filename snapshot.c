@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+#include "a8.h"
+
+// True if path starts with the snapshot magic
+bool is_snapshot(const char *path) {
+    char magic[8] = {0};
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    size_t got = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return got == sizeof(magic) && memcmp(magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0;
+}
+
+// Write zero bytes until the file position reaches at
+static int pad_to(FILE *file, uint64_t at) {
+    static const char zeros[SNAPSHOT_ALIGN];
+    long pos = ftell(file);
+    if (pos < 0) return -1;
+    size_t gap = at - (uint64_t)pos;
+    return fwrite(zeros, 1, gap, file) == gap ? 0 : -1;
+}
+
+// Write a frozen graph as a snapshot
+int save_snapshot(const Graph *graph, const char *path) {
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(SnapshotHeader);
+    header.V = graph->V;
+    header.N = graph->N;
+    header.E = graph->E;
+    header.min_weight = graph->min_weight;
+    header.max_weight = graph->max_weight;
+
+    size_t offsets_bytes = ((size_t)graph->V + 1) * sizeof(int64_t);
+    size_t targets_bytes = graph->E * sizeof(int);
+    size_t weights_bytes = (size_t)graph->N * graph->E * sizeof(int);
+    header.offsets_at = align_up(sizeof(SnapshotHeader), SNAPSHOT_ALIGN);
+    header.targets_at = align_up(header.offsets_at + offsets_bytes, SNAPSHOT_ALIGN);
+    header.weights_at = align_up(header.targets_at + targets_bytes, SNAPSHOT_ALIGN);
+    header.file_size = header.weights_at + weights_bytes;
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        perror("Error creating snapshot");
+        return -1;
+    }
+    int status = 0;
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        pad_to(file, header.offsets_at) != 0 ||
+        fwrite(graph->offsets, 1, offsets_bytes, file) != offsets_bytes ||
+        pad_to(file, header.targets_at) != 0 ||
+        fwrite(graph->targets, 1, targets_bytes, file) != targets_bytes ||
+        pad_to(file, header.weights_at) != 0 ||
+        fwrite(graph->weights, 1, weights_bytes, file) != weights_bytes) {
+        status = -1;
+    }
+    if (fclose(file) != 0) status = -1;
+    if (status != 0) fprintf(stderr, "Error writing snapshot %s\n", path);
+    return status;
+}
+
+// Check every row offset, target and weight against the header
+static const char *check_arrays(const SnapshotHeader *header, const void *mapping) {
+    const int64_t *offsets = (const int64_t *)((const char *)mapping + header->offsets_at);
+    const int *targets = (const int *)((const char *)mapping + header->targets_at);
+    const int *weights = (const int *)((const char *)mapping + header->weights_at);
+    for (int v = 0; v < header->V; v++) {
+        if (offsets[v + 1] < offsets[v]) return "inconsistent row offsets";
+    }
+    for (int64_t e = 0; e < header->E; e++) {
+        if (targets[e] < 0 || targets[e] >= header->V) return "edge target out of range";
+    }
+    size_t nweights = (size_t)header->N * header->E;
+    for (size_t i = 0; i < nweights; i++) {
+        if (weights[i] < header->min_weight || weights[i] > header->max_weight) {
+            return "weight out of range";
+        }
+    }
+    return NULL;
+}
+
+// Whether the array of count items of size bytes at offset at ends by
+// limit, in overflow-checked 64-bit arithmetic
+static bool array_fits(uint64_t at, uint64_t count, uint64_t size, uint64_t limit) {
+    uint64_t bytes;
+    uint64_t end;
+    return !__builtin_mul_overflow(count, size, &bytes) && !__builtin_add_overflow(at, bytes, &end) &&
+           end <= limit;
+}
+
+// The header alone, plus the two row offsets that bound the edge array
+static const char *check_header(const SnapshotHeader *header, uint64_t file_size, const void *mapping) {
+    if (header->version != SNAPSHOT_VERSION || header->header_size != sizeof(SnapshotHeader)) {
+        return "unsupported version";
+    }
+    uint64_t nweights;
+    if (header->V <= 0 || header->N <= 0 || header->E < 0 || header->file_size != file_size ||
+        header->offsets_at % SNAPSHOT_ALIGN || header->targets_at % SNAPSHOT_ALIGN ||
+        header->weights_at % SNAPSHOT_ALIGN || header->offsets_at < sizeof(SnapshotHeader) ||
+        !array_fits(header->offsets_at, (uint64_t)header->V + 1, sizeof(int64_t), header->targets_at) ||
+        !array_fits(header->targets_at, (uint64_t)header->E, sizeof(int), header->weights_at) ||
+        __builtin_mul_overflow((uint64_t)header->N, (uint64_t)header->E, &nweights) ||
+        !array_fits(header->weights_at, nweights, sizeof(int), file_size)) {
+        return "inconsistent header";
+    }
+    if (header->E > 0 && header->min_weight > header->max_weight) return "inconsistent weight range";
+    const int64_t *offsets = (const int64_t *)((const char *)mapping + header->offsets_at);
+    if (offsets[0] != 0 || offsets[header->V] != header->E) return "inconsistent row offsets";
+    return NULL;
+}
+
+// Map a snapshot read-only and point a Graph at its arrays. Loading only
+// checks the header, so it costs the same for any size of graph; verify
+// also reads every array, which --convert output never needs.
+Graph *load_snapshot(const char *path, bool verify) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening snapshot");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        fprintf(stderr, "Snapshot %s is truncated\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Error mapping snapshot");
+        return NULL;
+    }
+
+    const SnapshotHeader *header = mapping;
+    const char *problem = check_header(header, st.st_size, mapping);
+    if (!problem && verify) problem = check_arrays(header, mapping);
+    if (problem) {
+        fprintf(stderr, "Snapshot %s: %s\n", path, problem);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+
+    Graph *graph = calloc(1, sizeof(Graph));
+    if (!graph) {
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    graph->V = header->V;
+    graph->N = header->N;
+    graph->E = header->E;
+    graph->min_weight = header->min_weight;
+    graph->max_weight = header->max_weight;
+    graph->offsets = (int64_t *)((char *)mapping + header->offsets_at);
+    graph->targets = (int *)((char *)mapping + header->targets_at);
+    graph->weights = (int *)((char *)mapping + header->weights_at);
+    graph->mapping = mapping;
+    graph->mapping_size = st.st_size;
+    return graph;
+}
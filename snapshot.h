@@ -0,0 +1,37 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "graph.h"
+
+#define SNAPSHOT_MAGIC "A8GRAPH"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ALIGN 64
+
+// On-disk header of a binary graph snapshot
+//
+// The header is followed by the frozen CSR arrays exactly as Graph holds
+// them in memory (int64 offsets, int targets, phase-major int weights),
+// each starting on a SNAPSHOT_ALIGN boundary, so a mapped file is used in
+// place without parsing or copying. All fields are host byte order.
+typedef struct SnapshotHeader {
+    char magic[8];       // SNAPSHOT_MAGIC, NUL padded
+    uint32_t version;
+    uint32_t header_size;
+    int32_t V;
+    int32_t N;
+    int64_t E;
+    int32_t min_weight;
+    int32_t max_weight;
+    uint64_t offsets_at; // Byte offset of V + 1 int64 row offsets
+    uint64_t targets_at; // Byte offset of E int targets
+    uint64_t weights_at; // Byte offset of N * E int weights
+    uint64_t file_size;
+} SnapshotHeader;
+
+bool is_snapshot(const char *path);
+int save_snapshot(const Graph *graph, const char *path);
+Graph *load_snapshot(const char *path, bool verify);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "stats.h"
+#include "query.h"
+#include "perf.h"
+#include "profile.h"
+
+// Open the log at path, or on stderr when path is NULL
+StatsLog *open_stats_log(const char *path, bool search_counters) {
+    StatsLog *log = calloc(1, sizeof(StatsLog));
+    if (!log) return NULL;
+    log->out = stderr;
+    log->search_counters = search_counters;
+    if (path) {
+        log->out = fopen(path, "w");
+        if (!log->out) {
+            perror(path);
+            free(log);
+            return NULL;
+        }
+        log->owned = true;
+    }
+    return log;
+}
+
+static void write_counters(const StatsLog *log, const SearchStats *stats) {
+    FILE *out = log->out;
+    if (log->search_counters) {
+        fprintf(out, ", \"searches\": %u, \"pushes\": %llu, \"pops\": %llu, \"stale_pops\": %llu, "
+                     "\"relaxations\": %llu, \"improvements\": %llu, \"settled\": %llu, "
+                     "\"max_queue\": %llu",
+                stats->searches, (unsigned long long)stats->pushes, (unsigned long long)stats->pops,
+                (unsigned long long)stats->stale_pops, (unsigned long long)stats->relaxations,
+                (unsigned long long)stats->improvements, (unsigned long long)stats->settled,
+                (unsigned long long)stats->max_queue);
+    }
+    if (!stats->counted) return;
+    for (int k = 0; k < COUNTER_KINDS; k++) {
+        if (stats->counted & 1u << k) {
+            fprintf(out, ", \"%s\": %llu", counter_names[k], (unsigned long long)stats->counters[k]);
+        }
+    }
+    uint32_t ipc = 1u << COUNTER_CYCLES | 1u << COUNTER_INSTRUCTIONS;
+    if ((stats->counted & ipc) == ipc && stats->counters[COUNTER_CYCLES] > 0) {
+        fprintf(out, ", \"ipc\": %.3f",
+                (double)stats->counters[COUNTER_INSTRUCTIONS] / stats->counters[COUNTER_CYCLES]);
+    }
+    // Misses per scanned edge, when the build counts relaxations
+    if (stats->relaxations == 0) return;
+    for (int k = COUNTER_L1D_MISSES; k <= COUNTER_DTLB_MISSES; k++) {
+        if (stats->counted & 1u << k) {
+            fprintf(out, ", \"%s_per_relaxation\": %.4f", counter_names[k],
+                    (double)stats->counters[k] / stats->relaxations);
+        }
+    }
+}
+
+// Write one query's line and fold it into the totals; called in input
+// order from the thread that prints answers
+void log_query_stats(StatsLog *log, const Query *query) {
+    const SearchStats *stats = &query->stats;
+    fprintf(log->out, "{\"query\": %zu, \"start\": %d, \"end\": %d, \"path_len\": %d",
+            log->queries, query->start, query->end, query->path ? query->path_len : 0);
+    write_counters(log, stats);
+    if (log->search_counters) fprintf(log->out, ", \"us\": %.1f", stats->seconds * 1e6);
+    fprintf(log->out, "}\n");
+
+    log->queries++;
+    bool found = query->path != NULL;
+    for (int k = 0; query->profile && k < query->profile->N; k++) found |= query->profile->path[k] != NULL;
+    if (found) log->found++;
+    SearchStats *total = &log->total;
+    total->searches += stats->searches;
+    total->pushes += stats->pushes;
+    total->pops += stats->pops;
+    total->stale_pops += stats->stale_pops;
+    total->relaxations += stats->relaxations;
+    total->improvements += stats->improvements;
+    total->settled += stats->settled;
+    if (stats->max_queue > total->max_queue) total->max_queue = stats->max_queue;
+    total->seconds += stats->seconds;
+    if (stats->seconds > log->seconds_max) log->seconds_max = stats->seconds;
+    total->counted |= stats->counted;
+    for (int k = 0; k < COUNTER_KINDS; k++) total->counters[k] += stats->counters[k];
+}
+
+// Write the summary line and release the log
+void close_stats_log(StatsLog *log) {
+    fprintf(log->out, "{\"summary\": true, \"queries\": %zu, \"found\": %zu",
+            log->queries, log->found);
+    write_counters(log, &log->total);
+    if (log->search_counters) {
+        fprintf(log->out, ", \"search_s\": %.6f, \"max_us\": %.1f",
+                log->total.seconds, log->seconds_max * 1e6);
+    }
+    fprintf(log->out, "}\n");
+    if (log->owned) fclose(log->out);
+    free(log);
+}
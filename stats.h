@@ -0,0 +1,97 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+struct Query;
+
+// Counters read around each search by --perf, when the kernel allows
+typedef enum Counter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_DTLB_MISSES,
+    COUNTER_TASK_CLOCK,      // Nanoseconds on CPU; software, so usually there
+    COUNTER_KINDS
+} Counter;
+
+// Work done answering one query. The search counters are only maintained
+// in builds with -DA8_STATS (make STATS=1); otherwise every STAT_ hook
+// compiles to nothing and they stay zero. The hardware counters are filled
+// in any build when --perf could open them.
+//
+// Queries of a batch group share one search: its counters are charged to
+// the first query of the group and the others report searches == 0, so
+// summing over queries never counts a search twice.
+typedef struct SearchStats {
+    uint32_t searches;       // Searches this query paid for
+    uint64_t pushes;         // Queue pushes, decrease-keys included
+    uint64_t pops;           // Queue pops, stale ones included
+    uint64_t stale_pops;     // Pops of states that were already settled
+    uint64_t relaxations;    // Edges scanned from settled states
+    uint64_t improvements;   // Relaxations that lowered a label
+    uint64_t settled;        // States settled
+    uint64_t max_queue;      // Largest queue size seen
+    double seconds;          // Wall time of the search
+    uint32_t counted;        // Bit per Counter read for this search
+    uint64_t counters[COUNTER_KINDS];
+} SearchStats;
+
+#ifdef A8_STATS
+
+#define STATS_COMPILED true
+#define STAT_ADD(stats, field, n) ((stats).field += (n))
+#define STAT_MAX(stats, field, value) \
+    do { if ((uint64_t)(value) > (stats).field) (stats).field = (value); } while (0)
+
+static inline double stats_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Zero the counters of a workspace before a search
+static inline void stats_begin(SearchStats *stats) {
+    memset(stats, 0, sizeof(SearchStats));
+    stats->seconds = -stats_clock();
+}
+
+static inline void stats_end(SearchStats *stats) {
+    stats->seconds += stats_clock();
+    stats->searches = 1;
+}
+
+#else
+
+#define STATS_COMPILED false
+#define STAT_ADD(stats, field, n) ((void)0)
+#define STAT_MAX(stats, field, value) ((void)0)
+
+static inline void stats_begin(SearchStats *stats) { (void)stats; }
+static inline void stats_end(SearchStats *stats) { (void)stats; }
+
+#endif // A8_STATS
+
+// Per-query JSON lines in input order, then one summary line on close.
+// Search counters are written when the build has them, hardware counters
+// when they were read.
+typedef struct StatsLog {
+    FILE *out;
+    bool owned;              // out was opened here and is closed on close
+    bool search_counters;
+    size_t queries;
+    size_t found;
+    SearchStats total;       // Sums, except max_queue and seconds_max
+    double seconds_max;
+} StatsLog;
+
+StatsLog *open_stats_log(const char *path, bool search_counters);
+void log_query_stats(StatsLog *log, const struct Query *query);
+void close_stats_log(StatsLog *log);
+
+#endif // STATS_H
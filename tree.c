@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tree.h"
+#include "a8.h"
+
+// Bytes of the retained labels plus the repair scratch
+size_t hot_tree_bytes(int V, int N, int count) {
+    size_t states = (size_t)V * N;
+    return states * (2 * sizeof(int)) * count + states * (sizeof(uint8_t) + sizeof(uint32_t));
+}
+
+// Cheapest src -> dest edge in phase p of graph, or INF if there is none
+static int cheapest_edge(const Graph *graph, int src, int dest, int p) {
+    const int *weights = graph->weights + (size_t)p * graph->E;
+    int best = INF;
+    for (int64_t e = graph->offsets[src]; e < graph->offsets[src + 1]; e++) {
+        if (graph->targets[e] == dest && weights[e] < best) best = weights[e];
+    }
+    return best;
+}
+
+// Label state t at cost through u if that is cheaper than what it has
+static int improve(HotTrees *hot, SourceTree *tree, size_t t, int u, int cost) {
+    if (cost >= tree->dist[t]) return 0;
+    tree->dist[t] = cost;
+    tree->prev[t] = u;
+    if (queue_push(hot->queue, t, cost) != 0) {
+        fprintf(stderr, "Out of memory growing queue\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Settle the queued states on graph, relaxing out of each one whose label
+// is still the one it was queued with
+static int settle(HotTrees *hot, SourceTree *tree, const Graph *graph) {
+    int N = graph->N;
+    HeapEntry current;
+    while (pop_state(hot->queue, &current)) {
+        size_t s = current.state;
+        // Bucket engines leave the dearer copies of improved states behind
+        if (current.key != tree->dist[s]) continue;
+        hot->relabelled++;
+        int u = s / N;
+        int next_step = (s % N + 1) % N;
+        const int *weights = graph->weights + (s % N) * graph->E;
+        for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            size_t t = (size_t)graph->targets[e] * N + next_step;
+            if (improve(hot, tree, t, u, current.key + weights[e]) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+// Full search for a new tree
+static int grow_tree(HotTrees *hot, SourceTree *tree) {
+    const Graph *graph = &tree->version->graph;
+    size_t states = (size_t)graph->V * graph->N;
+    for (size_t s = 0; s < states; s++) {
+        tree->dist[s] = INF;
+        tree->prev[s] = -1;
+    }
+    clear_queue(hot->queue);
+    size_t origin = (size_t)tree->source * graph->N;
+    tree->dist[origin] = 0;
+    queue_push(hot->queue, origin, 0);
+    return settle(hot, tree, graph);
+}
+
+// Build one tree per distinct source on version, which each tree references
+HotTrees *build_hot_trees(GraphVersion *version, const int *sources, int count, Engine engine) {
+    const Graph *graph = &version->graph;
+    size_t states = (size_t)graph->V * graph->N;
+    HotTrees *hot = calloc(1, sizeof(HotTrees));
+    if (!hot) return NULL;
+    hot->trees = calloc(count, sizeof(SourceTree));
+    hot->tree_of = malloc(graph->V * sizeof(int));
+    hot->queue = create_queue(engine, states, graph->max_weight);
+    hot->affected = calloc(states, sizeof(uint8_t));
+    hot->list = malloc(states * sizeof(uint32_t));
+    if (!hot->trees || !hot->tree_of || !hot->queue || !hot->affected || !hot->list) {
+        free_hot_trees(hot);
+        return NULL;
+    }
+    for (int v = 0; v < graph->V; v++) hot->tree_of[v] = -1;
+
+    for (int i = 0; i < count; i++) {
+        if (hot->tree_of[sources[i]] >= 0) continue;
+        SourceTree *tree = &hot->trees[hot->count];
+        tree->source = sources[i];
+        tree->dist = malloc(states * sizeof(int));
+        tree->prev = malloc(states * sizeof(int));
+        pthread_rwlock_init(&tree->lock, NULL);
+        acquire_version(version);
+        tree->version = version;
+        hot->tree_of[sources[i]] = hot->count++;
+        if (!tree->dist || !tree->prev || grow_tree(hot, tree) != 0) {
+            free_hot_trees(hot);
+            return NULL;
+        }
+    }
+    return hot;
+}
+
+// Mark state t and the subtree below it in the old version's tree
+static size_t mark_subtree(HotTrees *hot, SourceTree *tree, const Graph *old, size_t t, size_t marked) {
+    int N = old->N;
+    size_t next = marked;
+    hot->affected[t] = 1;
+    hot->list[marked++] = t;
+    // The list doubles as the work stack: children are appended behind it
+    for (; next < marked; next++) {
+        size_t s = hot->list[next];
+        int u = s / N;
+        int child_step = (s % N + 1) % N;
+        for (int64_t e = old->offsets[u]; e < old->offsets[u + 1]; e++) {
+            size_t c = (size_t)old->targets[e] * N + child_step;
+            if (!hot->affected[c] && tree->prev[c] == u && tree->dist[c] != INF) {
+                hot->affected[c] = 1;
+                hot->list[marked++] = c;
+            }
+        }
+    }
+    return marked;
+}
+
+// Bring one tree from its version to next, where updates are the changes
+// between the two
+static int repair_tree(HotTrees *hot, SourceTree *tree, GraphVersion *next,
+                       const Update *updates, size_t count) {
+    const Graph *old = &tree->version->graph;
+    const Graph *graph = &next->graph;
+    int N = graph->N;
+    int *dist = tree->dist;
+    int *prev = tree->prev;
+    clear_queue(hot->queue);
+
+    // Tree edges that got dearer or went away: their heads and everything
+    // below them lose their labels
+    size_t marked = 0;
+    for (size_t i = 0; i < count; i++) {
+        int a = updates[i].src;
+        int b = updates[i].dest;
+        for (int p = 0; p < N; p++) {
+            size_t t = (size_t)b * N + (p + 1) % N;
+            size_t s = (size_t)a * N + p;
+            if (hot->affected[t] || prev[t] != a || dist[t] == INF) continue;
+            int w = cheapest_edge(graph, a, b, p);
+            if (w == INF || dist[s] + w > dist[t]) marked = mark_subtree(hot, tree, old, t, marked);
+        }
+    }
+    for (size_t k = 0; k < marked; k++) {
+        dist[hot->list[k]] = INF;
+        prev[hot->list[k]] = -1;
+    }
+
+    // Relabel them from their cheapest unaffected in-neighbour
+    for (size_t k = 0; k < marked; k++) {
+        size_t t = hot->list[k];
+        int v = t / N;
+        int p = (t % N + N - 1) % N;
+        const int *weights = graph->rev_weights + (size_t)p * graph->E;
+        for (int64_t e = graph->rev_offsets[v]; e < graph->rev_offsets[v + 1]; e++) {
+            int u = graph->rev_sources[e];
+            size_t s = (size_t)u * N + p;
+            if (hot->affected[s] || dist[s] == INF) continue;
+            if (improve(hot, tree, t, u, dist[s] + weights[e]) != 0) return -1;
+        }
+    }
+
+    // Edges that got cheaper or were inserted can only lower the labels
+    // at their heads; affected tails are relaxed when they settle
+    for (size_t i = 0; i < count; i++) {
+        int a = updates[i].src;
+        int b = updates[i].dest;
+        if (updates[i].kind == UPDATE_DELETE) continue;
+        for (int p = 0; p < N; p++) {
+            size_t s = (size_t)a * N + p;
+            if (hot->affected[s] || dist[s] == INF) continue;
+            int w = cheapest_edge(graph, a, b, p);
+            if (w == INF) continue;
+            if (improve(hot, tree, (size_t)b * N + (p + 1) % N, a, dist[s] + w) != 0) return -1;
+        }
+    }
+
+    for (size_t k = 0; k < marked; k++) hot->affected[hot->list[k]] = 0;
+    return settle(hot, tree, graph);
+}
+
+// Repair every tree for the version that follows theirs. Needs the
+// reversed arrays of next. Returns -1, leaving the trees unusable, when
+// memory runs out.
+int repair_hot_trees(HotTrees *hot, GraphVersion *next, const Update *updates, size_t count) {
+    hot->relabelled = 0;
+    for (int i = 0; i < hot->count; i++) {
+        SourceTree *tree = &hot->trees[i];
+        pthread_rwlock_wrlock(&tree->lock);
+        int status = repair_tree(hot, tree, next, updates, count);
+        GraphVersion *old = tree->version;
+        // A failed repair leaves a version no query will ask for
+        tree->version = status == 0 ? next : NULL;
+        if (status == 0) acquire_version(next);
+        pthread_rwlock_unlock(&tree->lock);
+        if (old) release_version(old);
+        if (status != 0) return -1;
+    }
+    return 0;
+}
+
+// Answer start -> end from start's tree when it is exact for version.
+// Returns false when there is no such tree; *path is NULL when end is
+// not reached.
+bool hot_tree_path(HotTrees *hot, const GraphVersion *version, int start, int end,
+                   int **path, int *path_len) {
+    int index = hot->tree_of[start];
+    if (index < 0) return false;
+    SourceTree *tree = &hot->trees[index];
+    pthread_rwlock_rdlock(&tree->lock);
+    if (tree->version != version) {
+        pthread_rwlock_unlock(&tree->lock);
+        return false;
+    }
+
+    int N = version->graph.N;
+    int min_cost = INF;
+    int final_step = -1;
+    for (int p = 0; p < N; p++) {
+        if (tree->dist[(size_t)end * N + p] < min_cost) {
+            min_cost = tree->dist[(size_t)end * N + p];
+            final_step = p;
+        }
+    }
+    *path = NULL;
+    *path_len = 0;
+    if (min_cost != INF) {
+        int len = 0;
+        for (int at = end, step = final_step; at != -1; step = (step - 1 + N) % N) {
+            len++;
+            at = tree->prev[(size_t)at * N + step];
+        }
+        *path = malloc(len * sizeof(int));
+        if (*path) {
+            // Walk back from end, filling the path from its far end
+            *path_len = len;
+            for (int at = end, step = final_step; at != -1; step = (step - 1 + N) % N) {
+                (*path)[--len] = at;
+                at = tree->prev[(size_t)at * N + step];
+            }
+        }
+    }
+    pthread_rwlock_unlock(&tree->lock);
+    return true;
+}
+
+void free_hot_trees(HotTrees *hot) {
+    for (int i = 0; i < hot->count; i++) {
+        SourceTree *tree = &hot->trees[i];
+        free(tree->dist);
+        free(tree->prev);
+        pthread_rwlock_destroy(&tree->lock);
+        if (tree->version) release_version(tree->version);
+    }
+    free(hot->trees);
+    free(hot->tree_of);
+    if (hot->queue) free_queue(hot->queue);
+    free(hot->affected);
+    free(hot->list);
+    free(hot);
+}
@@ -0,0 +1,48 @@
+#ifndef TREE_H
+#define TREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "graph.h"
+#include "queue.h"
+#include "update.h"
+
+// Complete shortest-path tree from phase 0 of one source over every
+// (vertex, phase) state, kept exact for one graph version
+typedef struct SourceTree {
+    int source;
+    GraphVersion *version;   // Version the labels are exact for (referenced)
+    int *dist;               // V x N, INF when unreached
+    int *prev;               // Predecessor vertex per state, -1 at the root and when unreached
+    pthread_rwlock_t lock;   // Workers read under it, repairs write
+} SourceTree;
+
+// Retained trees of the hot sources given with --hot
+//
+// When a run of updates is published, each tree is repaired in the manner
+// of Ramalingam and Reps instead of being recomputed: states whose tree
+// edge got dearer or disappeared are collected with their subtrees and
+// relabelled from their unaffected in-neighbours, cheaper and inserted
+// edges seed the queue directly, and a Dijkstra pass over the new version
+// settles only what changed. Repairs run on the reader thread; the
+// scratch below belongs to it.
+typedef struct HotTrees {
+    int count;
+    SourceTree *trees;
+    int *tree_of;            // V: tree rooted at each vertex, or -1
+    Queue *queue;
+    uint8_t *affected;       // V x N marks of the repair in progress
+    uint32_t *list;          // The marked states, in discovery order
+    size_t relabelled;       // States the last repair settled again
+} HotTrees;
+
+size_t hot_tree_bytes(int V, int N, int count);
+HotTrees *build_hot_trees(GraphVersion *version, const int *sources, int count, Engine engine);
+int repair_hot_trees(HotTrees *hot, GraphVersion *next, const Update *updates, size_t count);
+bool hot_tree_path(HotTrees *hot, const GraphVersion *version, int start, int end,
+                   int **path, int *path_len);
+void free_hot_trees(HotTrees *hot);
+
+#endif // TREE_H
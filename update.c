@@ -0,0 +1,466 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+#include "update.h"
+
+// Parse "U src dest w..", "I src dest w.." or "D src dest"
+static int parse_update(CommandReader *reader, const char *text, Update *update) {
+    update->kind = *text == 'U' ? UPDATE_WEIGHTS : *text == 'I' ? UPDATE_INSERT : UPDATE_DELETE;
+    update->weights = NULL;
+    update->line = reader->line_number;
+    char *after_src;
+    char *end;
+    long src = strtol(text + 1, &after_src, 10);
+    long dest = strtol(after_src, &end, 10);
+    if (after_src == text + 1 || end == after_src ||
+        src < 0 || src >= reader->V || dest < 0 || dest >= reader->V) {
+        fprintf(stderr, "line %zu: update needs two vertices in 0..%d\n", reader->line_number, reader->V - 1);
+        return -1;
+    }
+    update->src = reader->to_inner ? reader->to_inner[src] : (int)src;
+    update->dest = reader->to_inner ? reader->to_inner[dest] : (int)dest;
+
+    if (update->kind != UPDATE_DELETE) {
+        update->weights = malloc(reader->N * sizeof(int));
+        if (!update->weights) {
+            fprintf(stderr, "Out of memory reading updates\n");
+            return -1;
+        }
+        for (int p = 0; p < reader->N; p++) {
+            char *next;
+            long w = strtol(end, &next, 10);
+            // Dijkstra and the monotone queues need non-negative weights
+            if (next == end || w < 0 || w > INT_MAX) {
+                fprintf(stderr, "line %zu: update needs %d non-negative weights\n",
+                        reader->line_number, reader->N);
+                free(update->weights);
+                update->weights = NULL;
+                return -1;
+            }
+            update->weights[p] = (int)w;
+            end = next;
+        }
+    }
+    while (isspace((unsigned char)*end)) end++;
+    if (*end != '\0') {
+        fprintf(stderr, "line %zu: unexpected text after the update\n", reader->line_number);
+        free(update->weights);
+        update->weights = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Read the next query or update, reporting and skipping malformed lines
+Command read_command(CommandReader *reader, Query *query, Update *update) {
+    while (getline(&reader->line, &reader->capacity, reader->in) >= 0) {
+        reader->line_number++;
+        const char *text = reader->line;
+        while (isspace((unsigned char)*text)) text++;
+        if (*text == '\0') continue;
+        if (*text == 'U' || *text == 'I' || *text == 'D') {
+            if (parse_update(reader, text, update) == 0) return COMMAND_UPDATE;
+            continue;
+        }
+        if (parse_query(text, query) == 0) return COMMAND_QUERY;
+        fprintf(stderr, "line %zu: expected a query or an update\n", reader->line_number);
+    }
+    return COMMAND_END;
+}
+
+void free_updates(Update *updates, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(updates[i].weights);
+        updates[i].weights = NULL;
+    }
+}
+
+// Version 0 borrows the loaded graph and its reachability index, which the
+// caller frees after the last version is released
+GraphVersion *initial_version(const Graph *graph, Reachability *reach) {
+    GraphVersion *version = calloc(1, sizeof(GraphVersion));
+    Topology *topology = calloc(1, sizeof(Topology));
+    if (!version || !topology) {
+        free(version);
+        free(topology);
+        return NULL;
+    }
+    topology->refs = 1;
+    topology->offsets = graph->offsets;
+    topology->targets = graph->targets;
+    topology->rev_offsets = graph->rev_offsets;
+    topology->rev_sources = graph->rev_sources;
+    topology->reach = reach;
+    topology->weights_fd = -1;
+    version->refs = 1;
+    version->graph = *graph;
+    version->graph.mapping = NULL;
+    version->topology = topology;
+    return version;
+}
+
+void acquire_version(GraphVersion *version) {
+    __atomic_add_fetch(&version->refs, 1, __ATOMIC_RELAXED);
+}
+
+static void release_topology(Topology *topology) {
+    if (__atomic_sub_fetch(&topology->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    if (topology->owned) {
+        free(topology->offsets);
+        free(topology->targets);
+        free(topology->rev_offsets);
+        free(topology->rev_sources);
+        if (topology->reach) free_reachability(topology->reach);
+    }
+    if (topology->weights_fd >= 0) close(topology->weights_fd);
+    free(topology->rev_index);
+    free(topology->changed);
+    free(topology->changed_weights);
+    free(topology);
+}
+
+void release_version(GraphVersion *version) {
+    if (__atomic_sub_fetch(&version->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    if (version->graph.mapping) {
+        munmap(version->graph.mapping, version->graph.mapping_size);
+    } else if (version->number > 0) {
+        free(version->graph.weights);
+        free(version->graph.rev_weights);
+    }
+    release_topology(version->topology);
+    free(version);
+}
+
+// Edges inserted by this batch, kept aside until the rows are rebuilt
+typedef struct Insertion {
+    int src;
+    int dest;
+    const int *weights;
+    bool alive;
+    size_t order;
+} Insertion;
+
+static int compare_insertions(const void *a, const void *b) {
+    const Insertion *x = a;
+    const Insertion *y = b;
+    if (x->src != y->src) return x->src < y->src ? -1 : 1;
+    return x->order < y->order ? -1 : (x->order > y->order);
+}
+
+// Rebuild the CSR rows without the deleted edges and with the live
+// insertions appended to their source rows
+static int rebuild_rows(Graph *graph, const Graph *old, const bool *dead, Insertion *inserted,
+                        size_t ninserted, const int *old_weights) {
+    int V = old->V;
+    int N = old->N;
+    qsort(inserted, ninserted, sizeof(Insertion), compare_insertions);
+    int64_t E = 0;
+    for (int64_t e = 0; e < old->E; e++) E += !dead[e];
+    for (size_t i = 0; i < ninserted; i++) E += inserted[i].alive;
+
+    size_t nweights = (size_t)N * E;
+    int64_t *offsets = malloc(((size_t)V + 1) * sizeof(int64_t));
+    int *targets = malloc((E ? E : 1) * sizeof(int));
+    int *weights = malloc((nweights ? nweights : 1) * sizeof(int));
+    if (!offsets || !targets || !weights) {
+        free(offsets);
+        free(targets);
+        free(weights);
+        return -1;
+    }
+    int64_t e = 0;
+    size_t next = 0;
+    for (int u = 0; u < V; u++) {
+        offsets[u] = e;
+        for (int64_t k = old->offsets[u]; k < old->offsets[u + 1]; k++) {
+            if (dead[k]) continue;
+            targets[e] = old->targets[k];
+            for (int p = 0; p < N; p++) weights[(size_t)p * E + e] = old_weights[(size_t)p * old->E + k];
+            e++;
+        }
+        for (; next < ninserted && inserted[next].src == u; next++) {
+            if (!inserted[next].alive) continue;
+            targets[e] = inserted[next].dest;
+            for (int p = 0; p < N; p++) weights[(size_t)p * E + e] = inserted[next].weights[p];
+            e++;
+        }
+    }
+    offsets[V] = e;
+    graph->E = E;
+    graph->offsets = offsets;
+    graph->targets = targets;
+    graph->weights = weights;
+    return 0;
+}
+
+
+// Reverse position of every edge, in the order graph_build_reverse()
+// fills them
+static int64_t *build_rev_index(const Graph *graph) {
+    int64_t *fill = malloc(((size_t)graph->V + 1) * sizeof(int64_t));
+    int64_t *index = malloc((graph->E ? graph->E : 1) * sizeof(int64_t));
+    if (!fill || !index) {
+        free(fill);
+        free(index);
+        return NULL;
+    }
+    memcpy(fill, graph->rev_offsets, ((size_t)graph->V + 1) * sizeof(int64_t));
+    for (int u = 0; u < graph->V; u++) {
+        for (int64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            index[e] = fill[graph->targets[e]]++;
+        }
+    }
+    free(fill);
+    return index;
+}
+
+static bool write_all(int fd, const void *data, size_t bytes, off_t at) {
+    const char *from = data;
+    while (bytes > 0) {
+        ssize_t n = pwrite(fd, from, bytes, at);
+        if (n <= 0) return false;
+        from += n;
+        bytes -= n;
+        at += n;
+    }
+    return true;
+}
+
+// Write the weights of graph to a fresh memfd and forget the changes made
+// before them. Leaves weights_fd at -1 when no memfd can be made.
+static void write_weights(Topology *topology, const Graph *graph) {
+    if (topology->weights_fd >= 0) close(topology->weights_fd);
+    topology->weights_fd = -1;
+    topology->changed_count = 0;
+    topology->rewritten = 0;
+
+    size_t bytes = (size_t)graph->N * graph->E * sizeof(int);
+    int fd = syscall(SYS_memfd_create, "a8-weights", MFD_CLOEXEC);
+    if (fd < 0) return;
+    if (ftruncate(fd, graph->rev_weights ? 2 * bytes : bytes) != 0 ||
+        !write_all(fd, graph->weights, bytes, 0) ||
+        (graph->rev_weights && !write_all(fd, graph->rev_weights, bytes, bytes))) {
+        close(fd);
+        return;
+    }
+    topology->weights_fd = fd;
+}
+
+// Record that edge e takes weights from the next version on
+static int log_change(Topology *topology, int N, int64_t e, const int *weights) {
+    if (topology->changed_count == topology->changed_capacity) {
+        size_t grown_capacity = topology->changed_capacity ? topology->changed_capacity * 2 : 64;
+        int64_t *changed = realloc(topology->changed, grown_capacity * sizeof(int64_t));
+        if (!changed) return -1;
+        topology->changed = changed;
+        int *grown = realloc(topology->changed_weights, grown_capacity * N * sizeof(int));
+        if (!grown) return -1;
+        topology->changed_weights = grown;
+        topology->changed_capacity = grown_capacity;
+    }
+    topology->changed[topology->changed_count] = e;
+    memcpy(topology->changed_weights + topology->changed_count * N, weights, N * sizeof(int));
+    topology->changed_count++;
+    return 0;
+}
+
+// Rewrite the changes from first on, patching the reverse weights through
+// the edges' reverse positions
+static void rewrite_edges(Graph *graph, const Topology *topology, size_t first) {
+    int N = graph->N;
+    int64_t E = graph->E;
+    for (size_t i = first; i < topology->changed_count; i++) {
+        int64_t e = topology->changed[i];
+        const int *weights = topology->changed_weights + i * N;
+        for (int p = 0; p < N; p++) {
+            graph->weights[(size_t)p * E + e] = weights[p];
+            if (graph->rev_weights) graph->rev_weights[(size_t)p * E + topology->rev_index[e]] = weights[p];
+        }
+    }
+}
+
+// Give a weight-only version the weights of old with the changes from
+// first on: a private mapping of the memfd with every change since it was
+// written, or a copy of old's weights when there is no memfd to map
+static int share_weights(GraphVersion *version, const Graph *old, size_t first) {
+    Topology *topology = version->topology;
+    Graph *graph = &version->graph;
+    size_t bytes = (size_t)graph->N * graph->E * sizeof(int);
+    if (topology->weights_fd >= 0) {
+        size_t mapping_size = old->rev_weights ? 2 * bytes : bytes;
+        void *mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                             topology->weights_fd, 0);
+        if (mapping != MAP_FAILED) {
+            graph->mapping = mapping;
+            graph->mapping_size = mapping_size;
+            graph->weights = mapping;
+            graph->rev_weights = old->rev_weights ? (int *)((char *)mapping + bytes) : NULL;
+            rewrite_edges(graph, topology, 0);
+            topology->rewritten += topology->changed_count * graph->N * (old->rev_weights ? 2 : 1);
+            return 0;
+        }
+    }
+
+    graph->weights = malloc(bytes ? bytes : 1);
+    graph->rev_weights = old->rev_weights ? malloc(bytes ? bytes : 1) : NULL;
+    if (!graph->weights || (old->rev_weights && !graph->rev_weights)) {
+        free(graph->weights);
+        free(graph->rev_weights);
+        return -1;
+    }
+    memcpy(graph->weights, old->weights, bytes);
+    if (old->rev_weights) memcpy(graph->rev_weights, old->rev_weights, bytes);
+    rewrite_edges(graph, topology, first);
+    // Without a memfd there is nothing for later changes to build on
+    if (topology->weights_fd < 0) topology->changed_count = 0;
+    return 0;
+}
+
+// Build the version that follows base once updates are applied in order.
+// Updates naming a missing edge are reported and skipped. Returns NULL
+// when memory runs out.
+GraphVersion *apply_updates(const GraphVersion *base, const Update *updates, size_t count, size_t budget) {
+    const Graph *old = &base->graph;
+    int N = old->N;
+    int64_t E = old->E;
+    size_t nweights = (size_t)N * E;
+    bool reshape = false;
+    size_t ninserted = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (updates[i].kind != UPDATE_WEIGHTS) reshape = true;
+        if (updates[i].kind == UPDATE_INSERT) ninserted++;
+    }
+
+    // Inserts and deletes rebuild the rows from a copy of the weights;
+    // weight-only runs log their changes with the shared topology
+    GraphVersion *version = calloc(1, sizeof(GraphVersion));
+    Topology *topology = reshape ? calloc(1, sizeof(Topology)) : base->topology;
+    int *weights = reshape ? malloc((nweights ? nweights : 1) * sizeof(int)) : NULL;
+    bool *dead = reshape ? calloc(E ? E : 1, sizeof(bool)) : NULL;
+    Insertion *inserted = malloc((ninserted ? ninserted : 1) * sizeof(Insertion));
+    size_t first = topology ? topology->changed_count : 0;
+    if (!version || !topology || (reshape && (!weights || !dead)) || !inserted) goto fail;
+    if (reshape) {
+        memcpy(weights, old->weights, nweights * sizeof(int));
+        topology->weights_fd = -1;
+    } else {
+        if (old->rev_weights && !topology->rev_index && !(topology->rev_index = build_rev_index(old))) {
+            goto fail;
+        }
+        // Each rewritten weight may copy a whole page; once that adds up to
+        // the size of the memfd, writing a fresh one is cheaper
+        size_t store_bytes = (old->rev_weights ? 2 : 1) * nweights * sizeof(int);
+        if (topology->weights_fd < 0 || topology->rewritten * (size_t)sysconf(_SC_PAGESIZE) > store_bytes) {
+            write_weights(topology, old);
+        }
+        first = topology->changed_count;
+    }
+    version->refs = 1;
+    version->number = base->number + 1;
+    version->graph = *old;
+    version->graph.weights = weights;
+    version->graph.mapping = NULL;
+    version->graph.mapping_size = 0;
+    if (reshape) {
+        version->graph.rev_offsets = NULL;
+        version->graph.rev_sources = NULL;
+        version->graph.rev_weights = NULL;
+    }
+
+    // Weights are rewritten in place in the copy or logged; deletions only
+    // mark edges until the rows are rebuilt
+    ninserted = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Update *update = &updates[i];
+        int found = 0;
+        if (update->kind == UPDATE_INSERT) {
+            Insertion *insertion = &inserted[ninserted];
+            insertion->src = update->src;
+            insertion->dest = update->dest;
+            insertion->weights = update->weights;
+            insertion->alive = true;
+            insertion->order = ninserted++;
+            found = 1;
+        } else {
+            for (int64_t e = old->offsets[update->src]; e < old->offsets[update->src + 1]; e++) {
+                if (old->targets[e] != update->dest || (dead && dead[e])) continue;
+                found++;
+                if (update->kind == UPDATE_DELETE) {
+                    dead[e] = true;
+                } else if (!reshape) {
+                    if (log_change(topology, N, e, update->weights) != 0) goto fail;
+                } else {
+                    for (int p = 0; p < N; p++) weights[(size_t)p * E + e] = update->weights[p];
+                }
+            }
+            for (size_t k = 0; k < ninserted; k++) {
+                Insertion *insertion = &inserted[k];
+                if (!insertion->alive || insertion->src != update->src || insertion->dest != update->dest) continue;
+                found++;
+                if (update->kind == UPDATE_DELETE) insertion->alive = false;
+                else insertion->weights = update->weights;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "line %zu: no edge to %s\n", update->line,
+                    update->kind == UPDATE_DELETE ? "delete" : "update");
+            continue;
+        }
+        for (int p = 0; update->weights && p < N; p++) {
+            if (update->weights[p] < version->graph.min_weight) version->graph.min_weight = update->weights[p];
+            if (update->weights[p] > version->graph.max_weight) version->graph.max_weight = update->weights[p];
+        }
+    }
+
+    if (reshape) {
+        if (rebuild_rows(&version->graph, old, dead, inserted, ninserted, weights) != 0) goto fail;
+        free(weights);
+        weights = NULL;
+        topology->refs = 1;
+        topology->owned = true;
+        topology->offsets = version->graph.offsets;
+        topology->targets = version->graph.targets;
+        version->topology = topology;
+        topology->reach = build_reachability(&version->graph, budget);
+    } else {
+        version->topology = topology;
+        if (share_weights(version, old, first) != 0) {
+            version->topology = NULL;
+            goto fail;
+        }
+        __atomic_add_fetch(&topology->refs, 1, __ATOMIC_RELAXED);
+    }
+    free(dead);
+    free(inserted);
+
+    // From here on release_version() frees whatever was built
+    if (!version->topology->reach) {
+        release_version(version);
+        return NULL;
+    }
+    if (reshape && old->rev_offsets) {
+        if (graph_build_reverse(&version->graph) != 0) {
+            release_version(version);
+            return NULL;
+        }
+        topology->rev_offsets = version->graph.rev_offsets;
+        topology->rev_sources = version->graph.rev_sources;
+    }
+    return version;
+
+fail:
+    fprintf(stderr, "Out of memory applying updates\n");
+    free(version);
+    free(weights);
+    free(dead);
+    free(inserted);
+    if (reshape) free(topology);
+    else if (topology->changed_count > first) topology->changed_count = first;
+    return NULL;
+}
@@ -0,0 +1,94 @@
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "graph.h"
+#include "reach.h"
+#include "query.h"
+
+// Edge changes read from the query stream with --updates
+typedef enum UpdateKind {
+    UPDATE_WEIGHTS,      // U src dest w0 .. wN-1: reweight every src -> dest edge
+    UPDATE_INSERT,       // I src dest w0 .. wN-1: add an edge
+    UPDATE_DELETE        // D src dest: remove every src -> dest edge
+} UpdateKind;
+
+typedef struct Update {
+    UpdateKind kind;
+    int src;
+    int dest;
+    int *weights;        // N weights, NULL for a delete
+    size_t line;         // Input line, for error messages
+} Update;
+
+// Edge structure shared by the versions that only differ in weights
+//
+// Those versions also share their weights copy-on-write: a memfd holds the
+// forward and reverse weights of one of them, and each later one maps it
+// privately and rewrites the edges changed since, so only the pages of
+// changed edges are copied. A fresh memfd is written once the pages the
+// rewrites may have copied add up to its size.
+typedef struct Topology {
+    int refs;
+    bool owned;              // false for the loaded graph's arrays
+    int64_t *offsets;
+    int *targets;
+    int64_t *rev_offsets;    // Reverse rows when searches need them
+    int *rev_sources;
+    int64_t *rev_index;      // E: reverse position of each edge, or NULL
+    Reachability *reach;
+
+    int weights_fd;          // -1 until a weight-only version needs it
+    int64_t *changed;        // Edges rewritten since the memfd was written
+    int *changed_weights;    // N per changed edge
+    size_t changed_count;
+    size_t changed_capacity;
+    size_t rewritten;        // Weights rewritten over all mappings since then
+} Topology;
+
+// One immutable state of the graph
+//
+// Queries take a reference to the current version when they are read and
+// search it until they are printed, so updates never wait for searches
+// and searches never see a half-applied update. The reader publishes each
+// run of updates as a new version with a pointer swap; an old version is
+// freed when its last query lets go, the reference counts standing in for
+// an RCU grace period. A version owns its weights and reverse weights,
+// malloc'ed or privately mapped, and shares its topology and reverse rows
+// when no edge was inserted or deleted.
+typedef struct GraphVersion {
+    int refs;
+    uint64_t number;
+    Graph graph;             // What searches read; arrays as described above
+    Topology *topology;
+} GraphVersion;
+
+// Line reader for the --updates protocol: "start end" queries and
+// U/I/D updates, one per line
+typedef struct CommandReader {
+    FILE *in;
+    int V;
+    int N;
+    const int *to_inner;     // Outer to inner ids for updates, or NULL
+    char *line;
+    size_t capacity;
+    size_t line_number;
+} CommandReader;
+
+typedef enum Command {
+    COMMAND_END,
+    COMMAND_QUERY,
+    COMMAND_UPDATE
+} Command;
+
+Command read_command(CommandReader *reader, Query *query, Update *update);
+void free_updates(Update *updates, size_t count);
+
+GraphVersion *initial_version(const Graph *graph, Reachability *reach);
+GraphVersion *apply_updates(const GraphVersion *base, const Update *updates, size_t count, size_t budget);
+void acquire_version(GraphVersion *version);
+void release_version(GraphVersion *version);
+
+#endif // UPDATE_H